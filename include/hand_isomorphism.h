@@ -11,6 +11,8 @@
  *   Structure: [[2],[2,3],[2,3,1],[2,3,1,1]]
  * - Flop recall: Perfect recall through turn, groups turn+river at river
  *   Structure: [[2],[2,3],[2,3,1],[2,3,2]]
+ * - Board first recall: Imperfect recall with the board dealt before the hole cards
+ *   Structure: [[2],[3,2],[4,2],[5,2]]
  * - Other abstractions: (future) Custom grouping strategies
  *
  * Street definitions:
@@ -22,7 +24,9 @@
 
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
+#include <cstring>
 
 extern "C" {
 
@@ -64,6 +68,141 @@ extern "C" {
      */
     void imperfect_recall_unindex(uint8_t *output, int street, uint64_t index);
 
+    /**
+     * Map a hand given as card masks to its isomorphic index for a given street (imperfect recall).
+     *
+     * A card mask has bit (rank << 2 | suit) set for each card it holds, so the cards
+     * of each suit are extracted with a few bit operations instead of card by card.
+     *
+     * @param street The betting round (0=preflop, 1=flop, 2=turn, 3=river)
+     * @param masks One card mask per round of the street's structure (see top of file)
+     * @return The isomorphic index for this hand class
+     */
+    uint64_t imperfect_recall_index_masks(int street, const uint64_t *masks);
+
+    /**
+     * Recover the canonical representative hand from an index as card masks (imperfect recall).
+     *
+     * @param masks Array receiving one card mask per round of the street's structure
+     * @param street The betting round (0=preflop, 1=flop, 2=turn, 3=river)
+     * @param index The isomorphic index to convert back to cards
+     */
+    void imperfect_recall_unindex_masks(uint64_t *masks, int street, uint64_t index);
+
+    /**
+     * Map many hands to their isomorphic indices for a given street (imperfect recall).
+     *
+     * Equivalent to calling imperfect_recall_index on each hand, but hands are indexed
+     * in blocks of 16 so per-call overhead is amortized and the indexing kernel
+     * runs across several hands at once.
+     *
+     * @param street The betting round (0=preflop, 1=flop, 2=turn, 3=river)
+     * @param cards n hands stored back to back, each laid out as for imperfect_recall_index
+     * @param n Number of hands
+     * @param out Array receiving the n indices
+     */
+    void imperfect_recall_index_batch(int street, const uint8_t *cards, size_t n, uint64_t *out);
+
+    /**
+     * Recover the canonical representative hands of many indices (imperfect recall).
+     *
+     * Equivalent to calling imperfect_recall_unindex on each index and produces
+     * identical cards.
+     *
+     * @param street The betting round (0=preflop, 1=flop, 2=turn, 3=river)
+     * @param indices Array of n isomorphic indices to convert back to cards
+     * @param n Number of indices
+     * @param out Array receiving n canonical hands stored back to back
+     */
+    void imperfect_recall_unindex_batch(int street, const uint64_t *indices, size_t n, uint8_t *out);
+
+    /**
+     * Relabel the suits of a hand to give the canonical hand of its index (imperfect recall).
+     *
+     * Produces the same cards as imperfect_recall_unindex of the hand's index without computing
+     * the index, so two hands are isomorphic exactly when their canonical hands are
+     * equal.
+     *
+     * @param street The betting round (0=preflop, 1=flop, 2=turn, 3=river)
+     * @param cards The cards, laid out as for imperfect_recall_index
+     * @param out_cards Array receiving the canonical hand
+     * @param out_suit_perm Array receiving the canonical suit of each suit of the hand; suits
+     *        holding the same cards get one of the canonical suits they share
+     */
+    void imperfect_recall_canonicalize(int street, const uint8_t *cards, uint8_t *out_cards, uint8_t out_suit_perm[4]);
+
+    /**
+     * Canonicalize many hands (imperfect recall).
+     *
+     * Equivalent to calling imperfect_recall_canonicalize on each hand.
+     *
+     * @param street The betting round (0=preflop, 1=flop, 2=turn, 3=river)
+     * @param cards n hands stored back to back, each laid out as for imperfect_recall_index
+     * @param n Number of hands
+     * @param out_cards Array receiving n canonical hands stored back to back
+     * @param out_suit_perms Array receiving 4 suits for each hand
+     */
+    void imperfect_recall_canonicalize_batch(int street, const uint8_t *cards, size_t n, uint8_t *out_cards, uint8_t *out_suit_perms);
+
+    /**
+     * Receives one hand of an index's orbit from the *_expand functions.
+     *
+     * @param cards The hand, laid out as for the recall type's unindex; only valid during the call
+     * @param user_data The pointer passed to the expand function
+     */
+    typedef void (*expand_callback)(const uint8_t *cards, void *user_data);
+
+    /**
+     * Count the hands whose index is index (imperfect recall).
+     *
+     * These are the distinct suit relabellings of the canonical hand, each counted once
+     * whatever the order of the cards dealt on one round.
+     *
+     * @param street The betting round (0=preflop, 1=flop, 2=turn, 3=river)
+     * @param index The isomorphic index
+     * @return The number of hands in the index's orbit, or 0 if index is out of range
+     */
+    uint64_t imperfect_recall_expand_count(int street, uint64_t index);
+
+    /**
+     * Visit every hand whose index is index (imperfect recall).
+     *
+     * Visits the hands counted by imperfect_recall_expand_count, starting from the canonical hand,
+     * so the cost is proportional to the size of the orbit rather than to the number of deals.
+     *
+     * @param street The betting round (0=preflop, 1=flop, 2=turn, 3=river)
+     * @param index The isomorphic index
+     * @param callback Called with each hand
+     * @param user_data Passed to the callback
+     * @return The number of hands visited, or 0 if index is out of range
+     */
+    uint64_t imperfect_recall_expand(int street, uint64_t index, expand_callback callback, void *user_data);
+
+    /**
+     * Get the number of hands whose index is index (imperfect recall).
+     *
+     * The same as imperfect_recall_expand_count, and at most 24. Weighting each canonical hand by its
+     * multiplicity gives the probability of its index over all deals.
+     *
+     * @param street The betting round (0=preflop, 1=flop, 2=turn, 3=river)
+     * @param index The isomorphic index
+     * @return The multiplicity of the index, or 0 if index is out of range
+     */
+    uint8_t imperfect_recall_multiplicity(int street, uint64_t index);
+
+    /**
+     * Get the multiplicities of a range of indices (imperfect recall).
+     *
+     * Equivalent to calling imperfect_recall_multiplicity on each index, but indices that differ
+     * only in suits with no equal suit share one multiplicity and are filled at once.
+     *
+     * @param street The betting round (0=preflop, 1=flop, 2=turn, 3=river)
+     * @param first The first index of the range
+     * @param n Number of indices; first + n must not exceed the number of indices of the street
+     * @param out Array receiving n multiplicities
+     */
+    void imperfect_recall_multiplicities(int street, uint64_t first, size_t n, uint8_t *out);
+
     // ========== Perfect Recall ==========
 
     /**
@@ -101,6 +240,201 @@ extern "C" {
      */
     void perfect_recall_unindex(uint8_t *output, int street, uint64_t index);
 
+    /**
+     * Map a hand given as card masks to its isomorphic index for a given street (perfect recall).
+     *
+     * A card mask has bit (rank << 2 | suit) set for each card it holds, so the cards
+     * of each suit are extracted with a few bit operations instead of card by card.
+     *
+     * @param street The betting round (0=preflop, 1=flop, 2=turn, 3=river)
+     * @param masks One card mask per round of the street's structure (see top of file)
+     * @return The isomorphic index for this hand class
+     */
+    uint64_t perfect_recall_index_masks(int street, const uint64_t *masks);
+
+    /**
+     * Recover the canonical representative hand from an index as card masks (perfect recall).
+     *
+     * @param masks Array receiving one card mask per round of the street's structure
+     * @param street The betting round (0=preflop, 1=flop, 2=turn, 3=river)
+     * @param index The isomorphic index to convert back to cards
+     */
+    void perfect_recall_unindex_masks(uint64_t *masks, int street, uint64_t index);
+
+    /**
+     * Map many hands to their isomorphic indices for a given street (perfect recall).
+     *
+     * Equivalent to calling perfect_recall_index on each hand, but hands are indexed
+     * in blocks of 16 so per-call overhead is amortized and the indexing kernel
+     * runs across several hands at once.
+     *
+     * @param street The betting round (0=preflop, 1=flop, 2=turn, 3=river)
+     * @param cards n hands stored back to back, each laid out as for perfect_recall_index
+     * @param n Number of hands
+     * @param out Array receiving the n indices
+     */
+    void perfect_recall_index_batch(int street, const uint8_t *cards, size_t n, uint64_t *out);
+
+    /**
+     * Recover the canonical representative hands of many indices (perfect recall).
+     *
+     * Equivalent to calling perfect_recall_unindex on each index and produces
+     * identical cards.
+     *
+     * @param street The betting round (0=preflop, 1=flop, 2=turn, 3=river)
+     * @param indices Array of n isomorphic indices to convert back to cards
+     * @param n Number of indices
+     * @param out Array receiving n canonical hands stored back to back
+     */
+    void perfect_recall_unindex_batch(int street, const uint64_t *indices, size_t n, uint8_t *out);
+
+    /**
+     * Relabel the suits of a hand to give the canonical hand of its index (perfect recall).
+     *
+     * Produces the same cards as perfect_recall_unindex of the hand's index without computing
+     * the index, so two hands are isomorphic exactly when their canonical hands are
+     * equal.
+     *
+     * @param street The betting round (0=preflop, 1=flop, 2=turn, 3=river)
+     * @param cards The cards, laid out as for perfect_recall_index
+     * @param out_cards Array receiving the canonical hand
+     * @param out_suit_perm Array receiving the canonical suit of each suit of the hand; suits
+     *        holding the same cards get one of the canonical suits they share
+     */
+    void perfect_recall_canonicalize(int street, const uint8_t *cards, uint8_t *out_cards, uint8_t out_suit_perm[4]);
+
+    /**
+     * Canonicalize many hands (perfect recall).
+     *
+     * Equivalent to calling perfect_recall_canonicalize on each hand.
+     *
+     * @param street The betting round (0=preflop, 1=flop, 2=turn, 3=river)
+     * @param cards n hands stored back to back, each laid out as for perfect_recall_index
+     * @param n Number of hands
+     * @param out_cards Array receiving n canonical hands stored back to back
+     * @param out_suit_perms Array receiving 4 suits for each hand
+     */
+    void perfect_recall_canonicalize_batch(int street, const uint8_t *cards, size_t n, uint8_t *out_cards, uint8_t *out_suit_perms);
+
+    /**
+     * Count the hands whose index is index (perfect recall).
+     *
+     * These are the distinct suit relabellings of the canonical hand, each counted once
+     * whatever the order of the cards dealt on one round.
+     *
+     * @param street The betting round (0=preflop, 1=flop, 2=turn, 3=river)
+     * @param index The isomorphic index
+     * @return The number of hands in the index's orbit, or 0 if index is out of range
+     */
+    uint64_t perfect_recall_expand_count(int street, uint64_t index);
+
+    /**
+     * Visit every hand whose index is index (perfect recall).
+     *
+     * Visits the hands counted by perfect_recall_expand_count, starting from the canonical hand,
+     * so the cost is proportional to the size of the orbit rather than to the number of deals.
+     *
+     * @param street The betting round (0=preflop, 1=flop, 2=turn, 3=river)
+     * @param index The isomorphic index
+     * @param callback Called with each hand
+     * @param user_data Passed to the callback
+     * @return The number of hands visited, or 0 if index is out of range
+     */
+    uint64_t perfect_recall_expand(int street, uint64_t index, expand_callback callback, void *user_data);
+
+    /**
+     * Get the number of hands whose index is index (perfect recall).
+     *
+     * The same as perfect_recall_expand_count, and at most 24. Weighting each canonical hand by its
+     * multiplicity gives the probability of its index over all deals.
+     *
+     * @param street The betting round (0=preflop, 1=flop, 2=turn, 3=river)
+     * @param index The isomorphic index
+     * @return The multiplicity of the index, or 0 if index is out of range
+     */
+    uint8_t perfect_recall_multiplicity(int street, uint64_t index);
+
+    /**
+     * Get the multiplicities of a range of indices (perfect recall).
+     *
+     * Equivalent to calling perfect_recall_multiplicity on each index, but indices that differ
+     * only in suits with no equal suit share one multiplicity and are filled at once.
+     *
+     * @param street The betting round (0=preflop, 1=flop, 2=turn, 3=river)
+     * @param first The first index of the range
+     * @param n Number of indices; first + n must not exceed the number of indices of the street
+     * @param out Array receiving n multiplicities
+     */
+    void perfect_recall_multiplicities(int street, uint64_t first, size_t n, uint8_t *out);
+
+    /**
+     * Incremental perfect recall indexing state.
+     *
+     * Holds the per-suit progress of one hand so that each street can be indexed
+     * at the cost of that street's cards only. The contents are opaque; the struct
+     * exists so callers can keep states on the stack or inside game-tree nodes
+     * without allocating. States may be copied to branch a deal.
+     */
+    struct perfect_recall_state {
+        uint32_t opaque[16];
+    };
+
+    /**
+     * Map a poker hand to its isomorphic index on every street (perfect recall).
+     *
+     * Costs the same as a single perfect_recall_index call on the river, instead of
+     * one call per street.
+     *
+     * @param cards Array of 7 cards in deal order (2 hole, 3 flop, turn, river)
+     * @param out Array receiving the index at streets 0 through 3
+     */
+    void perfect_recall_index_all(const uint8_t *cards, uint64_t out[4]);
+
+    /**
+     * Reset an incremental indexing state to before the preflop (perfect recall).
+     *
+     * @param state The state to initialize
+     */
+    void perfect_recall_state_init(perfect_recall_state *state);
+
+    /**
+     * Extend an incremental indexing state by the next street (perfect recall).
+     *
+     * The first call takes the 2 hole cards, the second the 3 flop cards, then the
+     * turn card and finally the river card. At most 4 calls may be made per state.
+     *
+     * @param state The state to advance
+     * @param cards Array of the cards dealt on the next street only
+     * @return The perfect recall index of the hand on the street just dealt
+     */
+    uint64_t perfect_recall_state_next_street(perfect_recall_state *state, const uint8_t *cards);
+
+    /**
+     * Get the index on an earlier street of the hand with an index (perfect recall).
+     *
+     * Gives perfect_recall_index(street_to, cards) of any hand with that index, computed
+     * from the index alone without unindexing its cards.
+     *
+     * @param street_from The street of index (0=preflop, 1=flop, 2=turn, 3=river)
+     * @param index The perfect recall index on street_from
+     * @param street_to The street to project to, no later than street_from
+     * @return The perfect recall index on street_to, or UINT64_MAX if index or street_to is out of range
+     */
+    uint64_t perfect_recall_project(int street_from, uint64_t index, int street_to);
+
+    /**
+     * Project many indices to an earlier street (perfect recall).
+     *
+     * Equivalent to calling perfect_recall_project on each index.
+     *
+     * @param street_from The street of the indices
+     * @param indices The perfect recall indices on street_from
+     * @param n Number of indices
+     * @param street_to The street to project to, no later than street_from
+     * @param out Array receiving n indices on street_to, UINT64_MAX for each invalid one
+     */
+    void perfect_recall_project_batch(int street_from, const uint64_t *indices, size_t n, int street_to, uint64_t *out);
+
     // ========== Flop Recall ==========
 
     /**
@@ -138,6 +472,156 @@ extern "C" {
      */
     void flop_recall_unindex(uint8_t *output, int street, uint64_t index);
 
+    /**
+     * Map a hand given as card masks to its isomorphic index for a given street (flop recall).
+     *
+     * A card mask has bit (rank << 2 | suit) set for each card it holds, so the cards
+     * of each suit are extracted with a few bit operations instead of card by card.
+     *
+     * @param street The betting round (0=preflop, 1=flop, 2=turn, 3=river)
+     * @param masks One card mask per round of the street's structure (see top of file)
+     * @return The isomorphic index for this hand class
+     */
+    uint64_t flop_recall_index_masks(int street, const uint64_t *masks);
+
+    /**
+     * Recover the canonical representative hand from an index as card masks (flop recall).
+     *
+     * @param masks Array receiving one card mask per round of the street's structure
+     * @param street The betting round (0=preflop, 1=flop, 2=turn, 3=river)
+     * @param index The isomorphic index to convert back to cards
+     */
+    void flop_recall_unindex_masks(uint64_t *masks, int street, uint64_t index);
+
+    /**
+     * Map many hands to their isomorphic indices for a given street (flop recall).
+     *
+     * Equivalent to calling flop_recall_index on each hand, but hands are indexed
+     * in blocks of 16 so per-call overhead is amortized and the indexing kernel
+     * runs across several hands at once.
+     *
+     * @param street The betting round (0=preflop, 1=flop, 2=turn, 3=river)
+     * @param cards n hands stored back to back, each laid out as for flop_recall_index
+     * @param n Number of hands
+     * @param out Array receiving the n indices
+     */
+    void flop_recall_index_batch(int street, const uint8_t *cards, size_t n, uint64_t *out);
+
+    /**
+     * Recover the canonical representative hands of many indices (flop recall).
+     *
+     * Equivalent to calling flop_recall_unindex on each index and produces
+     * identical cards.
+     *
+     * @param street The betting round (0=preflop, 1=flop, 2=turn, 3=river)
+     * @param indices Array of n isomorphic indices to convert back to cards
+     * @param n Number of indices
+     * @param out Array receiving n canonical hands stored back to back
+     */
+    void flop_recall_unindex_batch(int street, const uint64_t *indices, size_t n, uint8_t *out);
+
+    /**
+     * Relabel the suits of a hand to give the canonical hand of its index (flop recall).
+     *
+     * Produces the same cards as flop_recall_unindex of the hand's index without computing
+     * the index, so two hands are isomorphic exactly when their canonical hands are
+     * equal.
+     *
+     * @param street The betting round (0=preflop, 1=flop, 2=turn, 3=river)
+     * @param cards The cards, laid out as for flop_recall_index
+     * @param out_cards Array receiving the canonical hand
+     * @param out_suit_perm Array receiving the canonical suit of each suit of the hand; suits
+     *        holding the same cards get one of the canonical suits they share
+     */
+    void flop_recall_canonicalize(int street, const uint8_t *cards, uint8_t *out_cards, uint8_t out_suit_perm[4]);
+
+    /**
+     * Canonicalize many hands (flop recall).
+     *
+     * Equivalent to calling flop_recall_canonicalize on each hand.
+     *
+     * @param street The betting round (0=preflop, 1=flop, 2=turn, 3=river)
+     * @param cards n hands stored back to back, each laid out as for flop_recall_index
+     * @param n Number of hands
+     * @param out_cards Array receiving n canonical hands stored back to back
+     * @param out_suit_perms Array receiving 4 suits for each hand
+     */
+    void flop_recall_canonicalize_batch(int street, const uint8_t *cards, size_t n, uint8_t *out_cards, uint8_t *out_suit_perms);
+
+    /**
+     * Count the hands whose index is index (flop recall).
+     *
+     * These are the distinct suit relabellings of the canonical hand, each counted once
+     * whatever the order of the cards dealt on one round.
+     *
+     * @param street The betting round (0=preflop, 1=flop, 2=turn, 3=river)
+     * @param index The isomorphic index
+     * @return The number of hands in the index's orbit, or 0 if index is out of range
+     */
+    uint64_t flop_recall_expand_count(int street, uint64_t index);
+
+    /**
+     * Visit every hand whose index is index (flop recall).
+     *
+     * Visits the hands counted by flop_recall_expand_count, starting from the canonical hand,
+     * so the cost is proportional to the size of the orbit rather than to the number of deals.
+     *
+     * @param street The betting round (0=preflop, 1=flop, 2=turn, 3=river)
+     * @param index The isomorphic index
+     * @param callback Called with each hand
+     * @param user_data Passed to the callback
+     * @return The number of hands visited, or 0 if index is out of range
+     */
+    uint64_t flop_recall_expand(int street, uint64_t index, expand_callback callback, void *user_data);
+
+    /**
+     * Get the number of hands whose index is index (flop recall).
+     *
+     * The same as flop_recall_expand_count, and at most 24. Weighting each canonical hand by its
+     * multiplicity gives the probability of its index over all deals.
+     *
+     * @param street The betting round (0=preflop, 1=flop, 2=turn, 3=river)
+     * @param index The isomorphic index
+     * @return The multiplicity of the index, or 0 if index is out of range
+     */
+    uint8_t flop_recall_multiplicity(int street, uint64_t index);
+
+    /**
+     * Get the multiplicities of a range of indices (flop recall).
+     *
+     * Equivalent to calling flop_recall_multiplicity on each index, but indices that differ
+     * only in suits with no equal suit share one multiplicity and are filled at once.
+     *
+     * @param street The betting round (0=preflop, 1=flop, 2=turn, 3=river)
+     * @param first The first index of the range
+     * @param n Number of indices; first + n must not exceed the number of indices of the street
+     * @param out Array receiving n multiplicities
+     */
+    void flop_recall_multiplicities(int street, uint64_t first, size_t n, uint8_t *out);
+
+    // ========== All Recalls ==========
+
+    /**
+     * Indices of one deal on every street for each hand recall type.
+     */
+    struct all_indices {
+        uint64_t imperfect_recall[4];
+        uint64_t perfect_recall[4];
+        uint64_t flop_recall[4];
+    };
+
+    /**
+     * Map a 7 card deal to its imperfect, perfect and flop recall index on every street.
+     *
+     * Produces the same 12 indices as calling imperfect_recall_index, perfect_recall_index
+     * and flop_recall_index for each street, but decodes the cards once and shares the
+     * per-suit work of the streets the recall types have in common.
+     *
+     * @param cards Array of 7 cards in deal order (2 hole, 3 flop, turn, river)
+     * @param out Receives the indices
+     */
+    void index_all_recalls(const uint8_t cards[7], all_indices *out);
+
     // ========== Board Imperfect Recall ==========
 
     /**
@@ -175,4 +659,867 @@ extern "C" {
      */
     void board_imperfect_recall_unindex(uint8_t *output, int street, uint64_t index);
 
+    /**
+     * Map a board given as card masks to its isomorphic index for a given street (board imperfect recall).
+     *
+     * A card mask has bit (rank << 2 | suit) set for each card it holds, so the cards
+     * of each suit are extracted with a few bit operations instead of card by card.
+     *
+     * @param street The betting round (0-3)
+     * @param masks Array holding the card mask of the board
+     * @return The isomorphic index for this board class
+     */
+    uint64_t board_imperfect_recall_index_masks(int street, const uint64_t *masks);
+
+    /**
+     * Recover the canonical representative board from an index as card masks (board imperfect recall).
+     *
+     * @param masks Array receiving the card mask of the board
+     * @param street The betting round (0-3)
+     * @param index The isomorphic index to convert back to cards
+     */
+    void board_imperfect_recall_unindex_masks(uint64_t *masks, int street, uint64_t index);
+
+    /**
+     * Map many boards to their isomorphic indices for a given street (board imperfect recall).
+     *
+     * Equivalent to calling board_imperfect_recall_index on each board, but boards are indexed
+     * in blocks of 16 so per-call overhead is amortized and the indexing kernel
+     * runs across several boards at once.
+     *
+     * @param street The betting round (0-3)
+     * @param cards n boards stored back to back, each laid out as for board_imperfect_recall_index
+     * @param n Number of boards
+     * @param out Array receiving the n indices
+     */
+    void board_imperfect_recall_index_batch(int street, const uint8_t *cards, size_t n, uint64_t *out);
+
+    /**
+     * Recover the canonical representative boards of many indices (board imperfect recall).
+     *
+     * Equivalent to calling board_imperfect_recall_unindex on each index and produces
+     * identical cards.
+     *
+     * @param street The betting round (0-3)
+     * @param indices Array of n isomorphic indices to convert back to cards
+     * @param n Number of indices
+     * @param out Array receiving n canonical boards stored back to back
+     */
+    void board_imperfect_recall_unindex_batch(int street, const uint64_t *indices, size_t n, uint8_t *out);
+
+    /**
+     * Relabel the suits of a board to give the canonical board of its index (board imperfect recall).
+     *
+     * Produces the same cards as board_imperfect_recall_unindex of the board's index without computing
+     * the index, so two boards are isomorphic exactly when their canonical boards are
+     * equal.
+     *
+     * @param street The betting round (0=preflop, 1=flop, 2=turn, 3=river)
+     * @param cards The cards, laid out as for board_imperfect_recall_index
+     * @param out_cards Array receiving the canonical board
+     * @param out_suit_perm Array receiving the canonical suit of each suit of the board; suits
+     *        holding the same cards get one of the canonical suits they share
+     */
+    void board_imperfect_recall_canonicalize(int street, const uint8_t *cards, uint8_t *out_cards, uint8_t out_suit_perm[4]);
+
+    /**
+     * Canonicalize many boards (board imperfect recall).
+     *
+     * Equivalent to calling board_imperfect_recall_canonicalize on each board.
+     *
+     * @param street The betting round (0=preflop, 1=flop, 2=turn, 3=river)
+     * @param cards n boards stored back to back, each laid out as for board_imperfect_recall_index
+     * @param n Number of boards
+     * @param out_cards Array receiving n canonical boards stored back to back
+     * @param out_suit_perms Array receiving 4 suits for each board
+     */
+    void board_imperfect_recall_canonicalize_batch(int street, const uint8_t *cards, size_t n, uint8_t *out_cards, uint8_t *out_suit_perms);
+
+    /**
+     * Count the boards whose index is index (board imperfect recall).
+     *
+     * These are the distinct suit relabellings of the canonical board, each counted once
+     * whatever the order of the cards dealt on one round.
+     *
+     * @param street The betting round (0-3)
+     * @param index The isomorphic index
+     * @return The number of boards in the index's orbit, or 0 if index is out of range
+     */
+    uint64_t board_imperfect_recall_expand_count(int street, uint64_t index);
+
+    /**
+     * Visit every board whose index is index (board imperfect recall).
+     *
+     * Visits the boards counted by board_imperfect_recall_expand_count, starting from the canonical board,
+     * so the cost is proportional to the size of the orbit rather than to the number of deals.
+     *
+     * @param street The betting round (0-3)
+     * @param index The isomorphic index
+     * @param callback Called with each board
+     * @param user_data Passed to the callback
+     * @return The number of boards visited, or 0 if index is out of range
+     */
+    uint64_t board_imperfect_recall_expand(int street, uint64_t index, expand_callback callback, void *user_data);
+
+    /**
+     * Get the number of boards whose index is index (board imperfect recall).
+     *
+     * The same as board_imperfect_recall_expand_count, and at most 24. Weighting each canonical board by its
+     * multiplicity gives the probability of its index over all deals.
+     *
+     * @param street The betting round (0-3)
+     * @param index The isomorphic index
+     * @return The multiplicity of the index, or 0 if index is out of range
+     */
+    uint8_t board_imperfect_recall_multiplicity(int street, uint64_t index);
+
+    /**
+     * Get the multiplicities of a range of indices (board imperfect recall).
+     *
+     * Equivalent to calling board_imperfect_recall_multiplicity on each index, but indices that differ
+     * only in suits with no equal suit share one multiplicity and are filled at once.
+     *
+     * @param street The betting round (0-3)
+     * @param first The first index of the range
+     * @param n Number of indices; first + n must not exceed the number of indices of the street
+     * @param out Array receiving n multiplicities
+     */
+    void board_imperfect_recall_multiplicities(int street, uint64_t first, size_t n, uint8_t *out);
+
+    // ========== Board First Recall ==========
+
+    /**
+     * Get the number of unique hand indices for a given street (board first recall).
+     *
+     * Board first recall indexes each street independently like imperfect recall, but
+     * deals the board before the hole cards so that hands sharing a board are told apart
+     * by their hole cards alone. Structure: [[2],[3,2],[4,2],[5,2]]
+     *
+     * @param street The betting round (0=preflop, 1=flop, 2=turn, 3=river)
+     * @return The total number of isomorphic hand classes at this street
+     */
+    uint64_t num_board_first_recall_hands(int street);
+
+    /**
+     * Map a poker hand to its isomorphic index for a given street (board first recall).
+     *
+     * Cards are represented as uint8_t values where suit isomorphisms are
+     * automatically detected. Multiple hands that differ only by suit
+     * permutations will map to the same index.
+     *
+     * @param street The betting round (0=preflop, 1=flop, 2=turn, 3=river)
+     * @param cards Array of board cards followed by the 2 hole cards (only the hole cards preflop)
+     * @return The isomorphic index for this hand class
+     */
+    uint64_t board_first_recall_index(int street, const uint8_t *cards);
+
+    /**
+     * Recover the canonical representative hand from an index (board first recall).
+     *
+     * Given an index, returns the canonical (lexicographically first) hand
+     * that maps to this index. This is the inverse of board_first_recall_index.
+     *
+     * @param output Array to store the canonical hand cards
+     * @param street The betting round (0=preflop, 1=flop, 2=turn, 3=river)
+     * @param index The isomorphic index to convert back to cards
+     */
+    void board_first_recall_unindex(uint8_t *output, int street, uint64_t index);
+
+    /**
+     * Map a hand given as card masks to its isomorphic index for a given street (board first recall).
+     *
+     * A card mask has bit (rank << 2 | suit) set for each card it holds, so the cards
+     * of each suit are extracted with a few bit operations instead of card by card.
+     *
+     * @param street The betting round (0=preflop, 1=flop, 2=turn, 3=river)
+     * @param masks One card mask per round of the street's structure (see top of file)
+     * @return The isomorphic index for this hand class
+     */
+    uint64_t board_first_recall_index_masks(int street, const uint64_t *masks);
+
+    /**
+     * Recover the canonical representative hand from an index as card masks (board first recall).
+     *
+     * @param masks Array receiving one card mask per round of the street's structure
+     * @param street The betting round (0=preflop, 1=flop, 2=turn, 3=river)
+     * @param index The isomorphic index to convert back to cards
+     */
+    void board_first_recall_unindex_masks(uint64_t *masks, int street, uint64_t index);
+
+    /**
+     * Map many hands to their isomorphic indices for a given street (board first recall).
+     *
+     * Equivalent to calling board_first_recall_index on each hand, but hands are indexed
+     * in blocks of 16 so per-call overhead is amortized and the indexing kernel
+     * runs across several hands at once.
+     *
+     * @param street The betting round (0=preflop, 1=flop, 2=turn, 3=river)
+     * @param cards n hands stored back to back, each laid out as for board_first_recall_index
+     * @param n Number of hands
+     * @param out Array receiving the n indices
+     */
+    void board_first_recall_index_batch(int street, const uint8_t *cards, size_t n, uint64_t *out);
+
+    /**
+     * Recover the canonical representative hands of many indices (board first recall).
+     *
+     * Equivalent to calling board_first_recall_unindex on each index and produces
+     * identical cards.
+     *
+     * @param street The betting round (0=preflop, 1=flop, 2=turn, 3=river)
+     * @param indices Array of n isomorphic indices to convert back to cards
+     * @param n Number of indices
+     * @param out Array receiving n canonical hands stored back to back
+     */
+    void board_first_recall_unindex_batch(int street, const uint64_t *indices, size_t n, uint8_t *out);
+
+    /**
+     * Relabel the suits of a hand to give the canonical hand of its index (board first recall).
+     *
+     * Produces the same cards as board_first_recall_unindex of the hand's index without computing
+     * the index, so two hands are isomorphic exactly when their canonical hands are
+     * equal.
+     *
+     * @param street The betting round (0=preflop, 1=flop, 2=turn, 3=river)
+     * @param cards The cards, laid out as for board_first_recall_index
+     * @param out_cards Array receiving the canonical hand
+     * @param out_suit_perm Array receiving the canonical suit of each suit of the hand; suits
+     *        holding the same cards get one of the canonical suits they share
+     */
+    void board_first_recall_canonicalize(int street, const uint8_t *cards, uint8_t *out_cards, uint8_t out_suit_perm[4]);
+
+    /**
+     * Canonicalize many hands (board first recall).
+     *
+     * Equivalent to calling board_first_recall_canonicalize on each hand.
+     *
+     * @param street The betting round (0=preflop, 1=flop, 2=turn, 3=river)
+     * @param cards n hands stored back to back, each laid out as for board_first_recall_index
+     * @param n Number of hands
+     * @param out_cards Array receiving n canonical hands stored back to back
+     * @param out_suit_perms Array receiving 4 suits for each hand
+     */
+    void board_first_recall_canonicalize_batch(int street, const uint8_t *cards, size_t n, uint8_t *out_cards, uint8_t *out_suit_perms);
+
+    /**
+     * Count the hands whose index is index (board first recall).
+     *
+     * These are the distinct suit relabellings of the canonical hand, each counted once
+     * whatever the order of the cards dealt on one round.
+     *
+     * @param street The betting round (0=preflop, 1=flop, 2=turn, 3=river)
+     * @param index The isomorphic index
+     * @return The number of hands in the index's orbit, or 0 if index is out of range
+     */
+    uint64_t board_first_recall_expand_count(int street, uint64_t index);
+
+    /**
+     * Visit every hand whose index is index (board first recall).
+     *
+     * Visits the hands counted by board_first_recall_expand_count, starting from the canonical hand,
+     * so the cost is proportional to the size of the orbit rather than to the number of deals.
+     *
+     * @param street The betting round (0=preflop, 1=flop, 2=turn, 3=river)
+     * @param index The isomorphic index
+     * @param callback Called with each hand
+     * @param user_data Passed to the callback
+     * @return The number of hands visited, or 0 if index is out of range
+     */
+    uint64_t board_first_recall_expand(int street, uint64_t index, expand_callback callback, void *user_data);
+
+    /**
+     * Get the number of hands whose index is index (board first recall).
+     *
+     * The same as board_first_recall_expand_count, and at most 24. Weighting each canonical hand by its
+     * multiplicity gives the probability of its index over all deals.
+     *
+     * @param street The betting round (0=preflop, 1=flop, 2=turn, 3=river)
+     * @param index The isomorphic index
+     * @return The multiplicity of the index, or 0 if index is out of range
+     */
+    uint8_t board_first_recall_multiplicity(int street, uint64_t index);
+
+    /**
+     * Get the multiplicities of a range of indices (board first recall).
+     *
+     * Equivalent to calling board_first_recall_multiplicity on each index, but indices that differ
+     * only in suits with no equal suit share one multiplicity and are filled at once.
+     *
+     * @param street The betting round (0=preflop, 1=flop, 2=turn, 3=river)
+     * @param first The first index of the range
+     * @param n Number of indices; first + n must not exceed the number of indices of the street
+     * @param out Array receiving n multiplicities
+     */
+    void board_first_recall_multiplicities(int street, uint64_t first, size_t n, uint8_t *out);
+
+    /**
+     * Get the number of unique board indices for a given street (board first recall).
+     *
+     * @param street The betting round (0=preflop, 1=flop, 2=turn, 3=river)
+     * @return The number of isomorphic board classes at this street; 1 preflop, where the board is empty
+     */
+    uint64_t num_board_first_recall_boards(int street);
+
+    /**
+     * Map the board of a hand to its isomorphic index (board first recall).
+     *
+     * The index of the first round of the street's structure, so the same as
+     * board_imperfect_recall_index of the board after the preflop. Preflop it is always 0.
+     *
+     * @param street The betting round (0=preflop, 1=flop, 2=turn, 3=river)
+     * @param cards The cards, laid out as for board_first_recall_index; only the board is read
+     * @return The isomorphic index of the board
+     */
+    uint64_t board_first_recall_board_index(int street, const uint8_t *cards);
+
+    /**
+     * Get the number of hole card indices given a board (board first recall).
+     *
+     * The hands of a board class are split only by the suits the board leaves interchangeable,
+     * so this is at most 1326 and often far fewer, small enough for per-board tables.
+     *
+     * @param street The betting round (0=preflop, 1=flop, 2=turn, 3=river)
+     * @param board_index The isomorphic index of the board
+     * @return The number of hole card indices on the board, or 0 if board_index is out of range
+     */
+    uint64_t num_board_first_recall_holes(int street, uint64_t board_index);
+
+    /**
+     * Map the hole cards of a hand to their isomorphic index given its board (board first recall).
+     *
+     * The board index and the hole index together identify the hand's class: two hands are
+     * isomorphic exactly when both agree. The hole index is computed from the board's rank sets
+     * rather than from tables, and is dense in [0, num_board_first_recall_holes).
+     *
+     * @param street The betting round (0=preflop, 1=flop, 2=turn, 3=river)
+     * @param cards The cards, laid out as for board_first_recall_index
+     * @return The isomorphic index of the hole cards given the board
+     */
+    uint64_t board_first_recall_hole_index(int street, const uint8_t *cards);
+
+    /**
+     * Recover a hand from its board index and hole index (board first recall).
+     *
+     * The board is the canonical board of board_index, so the hand's board index and hole index
+     * are the ones given, though its hole cards need not be the canonical ones of
+     * board_first_recall_unindex.
+     *
+     * @param output Array receiving the board cards followed by the 2 hole cards
+     * @param street The betting round (0=preflop, 1=flop, 2=turn, 3=river)
+     * @param board_index The isomorphic index of the board
+     * @param hole_index The isomorphic index of the hole cards given the board
+     * @return false if either index is out of range
+     */
+    bool board_first_recall_unindex_hole(uint8_t *output, int street, uint64_t board_index, uint64_t hole_index);
+
+    // ========== Board Major Layout ==========
+
+    /**
+     * The indices of the hands sharing one board in the board major layout.
+     */
+    typedef struct board_major_range {
+        uint64_t first;     // the index of the board's first hand
+        uint64_t size;      // the number of hands on the board, as num_board_first_recall_holes
+    } board_major_range;
+
+    /**
+     * Get the number of board major indices for a given street.
+     *
+     * The board major layout indexes the same hand classes as imperfect recall, but orders
+     * them by board: the hands sharing a canonical board take consecutive indices, boards
+     * in the order of their board_first_recall_board_index and hands on a board in the order
+     * of their board_first_recall_hole_index. A sweep over the hands of a board then reads
+     * one contiguous range of a table instead of entries spread over the whole street.
+     *
+     * The first call builds the offset of each board on every street, about 0.6 MB.
+     *
+     * @param street The betting round (0=preflop, 1=flop, 2=turn, 3=river)
+     * @return The total number of isomorphic hand classes at this street, as num_imperfect_recall_hands
+     */
+    uint64_t num_board_major_hands(int street);
+
+    /**
+     * Map a poker hand to its board major index for a given street.
+     *
+     * @param street The betting round (0=preflop, 1=flop, 2=turn, 3=river)
+     * @param cards The cards, laid out as for imperfect_recall_index
+     * @return The board major index for this hand class
+     */
+    uint64_t board_major_index(int street, const uint8_t *cards);
+
+    /**
+     * Recover a hand from its board major index.
+     *
+     * The board is the canonical board of the hand's board, but the hole cards need not be
+     * the canonical ones of imperfect_recall_unindex.
+     *
+     * @param output Array receiving the cards, laid out as for imperfect_recall_index
+     * @param street The betting round (0=preflop, 1=flop, 2=turn, 3=river)
+     * @param index The board major index, which must be below num_board_major_hands
+     */
+    void board_major_unindex(uint8_t *output, int street, uint64_t index);
+
+    /**
+     * Get the board of a board major index.
+     *
+     * @param street The betting round (0=preflop, 1=flop, 2=turn, 3=river)
+     * @param index The board major index
+     * @return The board's index, as board_first_recall_board_index, or UINT64_MAX if index is out of range
+     */
+    uint64_t board_major_board(int street, uint64_t index);
+
+    /**
+     * Get the board major indices of the hands sharing a board.
+     *
+     * @param street The betting round (0=preflop, 1=flop, 2=turn, 3=river)
+     * @param board_index The board's index, as board_first_recall_board_index
+     * @return The board's range, or an empty range if board_index is out of range
+     */
+    board_major_range board_major_board_range(int street, uint64_t board_index);
+
+    // ========== Enumeration ==========
+
+    /**
+     * Hand recall types, for functions that take the recall type as an argument.
+     */
+    enum hand_recall {
+        IMPERFECT_RECALL,
+        PERFECT_RECALL,
+        FLOP_RECALL,
+        BOARD_IMPERFECT_RECALL,
+        BOARD_FIRST_RECALL
+    };
+
+    /**
+     * Receives a block of consecutive canonical hands from for_each_canonical.
+     *
+     * @param thread The worker calling, from 0 to the number of threads minus one
+     * @param first_index The index of the first hand in the block
+     * @param n Number of hands in the block
+     * @param cards n canonical hands stored back to back, laid out as for the recall type's unindex
+     * @param user_data The pointer passed to for_each_canonical
+     */
+    typedef void (*canonical_hands_callback)(int thread, uint64_t first_index, size_t n,
+                                             const uint8_t *cards, void *user_data);
+
+    /**
+     * Visit the canonical hand of every index of a street in parallel.
+     *
+     * The index space is split at configuration boundaries into chunks that are shared
+     * out evenly between the workers, and workers that run out steal chunks from the
+     * others. Each worker passes its chunks to the callback in blocks of consecutive
+     * indices. Blocks are visited in no particular order and the callback is called from
+     * several threads at once. Returns once every index has been visited.
+     *
+     * @param recall The recall type
+     * @param street The betting round (0=preflop, 1=flop, 2=turn, 3=river)
+     * @param callback Called with each block of canonical hands
+     * @param user_data Passed to the callback
+     * @param threads Number of workers, or 0 for one per hardware thread
+     */
+    void for_each_canonical(hand_recall recall, int street, canonical_hands_callback callback,
+                            void *user_data, int threads);
+
+    /**
+     * Walks the canonical hands of a street in index order.
+     *
+     * Moving to the next index only decodes the suits whose cards change, which is
+     * much cheaper than unindexing every index. The contents are opaque; iterators may
+     * be copied.
+     */
+    struct canonical_iterator {
+        uint64_t opaque[56];
+    };
+
+    /**
+     * Start an iterator at an index.
+     *
+     * @param iterator The iterator to initialize
+     * @param recall The recall type
+     * @param street The betting round (0=preflop, 1=flop, 2=turn, 3=river)
+     * @param index The first index to visit
+     * @return false if the index is out of range
+     */
+    bool canonical_iterator_init(canonical_iterator *iterator, hand_recall recall, int street, uint64_t index);
+
+    /**
+     * Move an iterator to the next index.
+     *
+     * @param iterator The iterator to advance
+     * @return false if the iterator was on the street's last index
+     */
+    bool canonical_iterator_next(canonical_iterator *iterator);
+
+    /**
+     * Move an iterator forward by a number of indices.
+     *
+     * @param iterator The iterator to advance
+     * @param stride Number of indices to skip forward
+     * @return false if that moves the iterator past the street's last index
+     */
+    bool canonical_iterator_advance(canonical_iterator *iterator, uint64_t stride);
+
+    /**
+     * @param iterator The iterator
+     * @return The index the iterator is on
+     */
+    uint64_t canonical_iterator_index(const canonical_iterator *iterator);
+
+    /**
+     * Get the canonical hand of the iterator's index.
+     *
+     * @param iterator The iterator
+     * @return The cards, laid out as for the recall type's unindex and valid until the iterator moves
+     */
+    const uint8_t *canonical_iterator_cards(const canonical_iterator *iterator);
+
+    // ========== Contexts ==========
+
+    /**
+     * One street of a recall type, resolved by hand_iso_ctx_create so that indexing it
+     * skips the recall type lookup, street lookup and initialization check of the
+     * functions above. Read through the functions below.
+     */
+    typedef struct hand_iso_street {
+        const struct hand_indexer_s *indexer;
+        uint32_t round;
+        uint64_t size;
+        uint64_t (*index)(const struct hand_iso_street *street, const uint8_t *cards);
+        uint64_t (*index_masks)(const struct hand_iso_street *street, const uint64_t *masks);
+        const void *kernel;
+    } hand_iso_street;
+
+    /**
+     * The streets of a recall type. Contexts are immutable and may be shared between threads.
+     */
+    typedef struct hand_iso_ctx {
+        hand_recall recall;
+        hand_iso_street streets[4];
+    } hand_iso_ctx;
+
+    /**
+     * Create a context for a recall type.
+     *
+     * Builds the recall type's lookup tables if it is not in use yet; contexts share
+     * the tables of the functions above. The kernels are those selected when the
+     * context is created, see hand_isomorphism_use_kernels.
+     *
+     * @param recall The recall type
+     * @return The context, or nullptr if out of memory
+     */
+    const hand_iso_ctx *hand_iso_ctx_create(hand_recall recall);
+
+    /**
+     * Free a context created by hand_iso_ctx_create.
+     *
+     * @param ctx The context
+     */
+    void hand_iso_ctx_free(const hand_iso_ctx *ctx);
+
+    /**
+     * Get the handle of one street of a context, valid as long as the context.
+     *
+     * @param ctx The context
+     * @param street The betting round (0=preflop, 1=flop, 2=turn, 3=river)
+     * @return The street's handle
+     */
+    static inline const hand_iso_street *hand_iso_ctx_street(const hand_iso_ctx *ctx, int street){
+        return &ctx->streets[street];
+    }
+
+    /**
+     * Get the number of indices of a street.
+     *
+     * @param street The street's handle
+     * @return The number of indices
+     */
+    static inline uint64_t hand_iso_street_size(const hand_iso_street *street){
+        return street->size;
+    }
+
+    /**
+     * Index a hand on a street, as the recall type's index function.
+     *
+     * @param street The street's handle
+     * @param cards The cards, laid out as for the recall type's index
+     * @return The index
+     */
+    static inline uint64_t hand_iso_street_index(const hand_iso_street *street, const uint8_t *cards){
+        return street->index(street, cards);
+    }
+
+    /**
+     * Index a hand given as card masks on a street, as the recall type's index_masks function.
+     *
+     * @param street The street's handle
+     * @param masks The card masks, laid out as for the recall type's index_masks
+     * @return The index
+     */
+    static inline uint64_t hand_iso_street_index_masks(const hand_iso_street *street, const uint64_t *masks){
+        return street->index_masks(street, masks);
+    }
+
+    /**
+     * Recover the canonical hand of an index on a street, as the recall type's unindex function.
+     *
+     * @param street The street's handle
+     * @param index The index
+     * @param output Receives the cards
+     */
+    void hand_iso_street_unindex(const hand_iso_street *street, uint64_t index, uint8_t *output);
+
+    /**
+     * Index a batch of hands on a street, as the recall type's index_batch function.
+     *
+     * @param street The street's handle
+     * @param cards n hands stored back to back
+     * @param n Number of hands
+     * @param out Receives n indices
+     */
+    void hand_iso_street_index_batch(const hand_iso_street *street, const uint8_t *cards, size_t n, uint64_t *out);
+
+    /**
+     * Recover the canonical hands of many indices on a street, as the recall type's
+     * unindex_batch function.
+     *
+     * @param street The street's handle
+     * @param indices The indices
+     * @param n Number of indices
+     * @param out Receives n hands stored back to back
+     */
+    void hand_iso_street_unindex_batch(const hand_iso_street *street, const uint64_t *indices, size_t n, uint8_t *out);
+
+    // ========== Successor Tables ==========
+
+    /**
+     * The entry of a successor table for a card that is already in the hand.
+     */
+    #define HAND_ISO_NO_SUCCESSOR UINT32_MAX
+
+    /**
+     * The index on the next street of every index of a street extended by each card.
+     *
+     * Cards are relative to the canonical hand of the index, as written by the recall type's
+     * unindex. A raw hand's next card is moved to its canonical hand's suits by the suit
+     * permutation from the recall type's canonicalize.
+     */
+    typedef struct hand_iso_successors {
+        hand_recall recall;
+        int street;             // the street of the indices; successors are on street + 1
+        uint64_t size;          // number of indices of the street
+        const uint32_t *table;  // 52 entries for each index
+        bool mapped;            // the table is mapped from a file
+    } hand_iso_successors;
+
+    /**
+     * Build the successor table of a street in parallel.
+     *
+     * The street must be the flop or the turn, whose next street deals one card. Under board
+     * first recall that card joins the board round of the next street's index. The table
+     * takes 208 bytes per index of the street: about 255 MB for the perfect recall flop
+     * and 11 GB for its turn.
+     *
+     * @param recall The recall type
+     * @param street The street of the indices, 1 or 2
+     * @param threads Number of workers, or 0 for one per hardware thread
+     * @return The table, or nullptr if the street has no successor table or out of memory
+     */
+    const hand_iso_successors *hand_iso_successors_build(hand_recall recall, int street, int threads);
+
+    /**
+     * Save a successor table to a file, which is versioned and checksummed.
+     *
+     * @param successors The table
+     * @param path File to create or overwrite
+     * @return true if the file was written
+     */
+    bool hand_iso_successors_save(const hand_iso_successors *successors, const char *path);
+
+    /**
+     * Map a successor table saved by hand_iso_successors_save read only, so processes using
+     * the same file share its pages.
+     *
+     * @param recall The recall type the table was built for
+     * @param street The street the table was built for
+     * @param path File to map
+     * @param verify Check the file's checksum, which reads the whole file
+     * @return The table, or nullptr if the file is missing or was built for another street
+     */
+    const hand_iso_successors *hand_iso_successors_map(hand_recall recall, int street, const char *path, bool verify);
+
+    /**
+     * Free a successor table, unmapping it if it was mapped.
+     *
+     * @param successors The table
+     */
+    void hand_iso_successors_free(const hand_iso_successors *successors);
+
+    /**
+     * Get the size of a successor table.
+     *
+     * @param successors The table
+     * @return The size of the table in bytes
+     */
+    static inline uint64_t hand_iso_successors_memory_usage(const hand_iso_successors *successors){
+        return successors->size * 52 * sizeof(uint32_t);
+    }
+
+    /**
+     * Get the index on the next street of an index extended by a card.
+     *
+     * @param successors The table
+     * @param index An index of the table's street
+     * @param card The next card, relative to the canonical hand of index
+     * @return The index on the next street, or HAND_ISO_NO_SUCCESSOR if card is in the hand
+     */
+    static inline uint32_t hand_iso_successor(const hand_iso_successors *successors, uint64_t index, uint8_t card){
+        return successors->table[index * 52 + card];
+    }
+
+    // ========== Projection Tables ==========
+
+    /**
+     * The index on a recall type's street of the hand of every perfect recall index of the
+     * street, such as the imperfect recall index of a perfect recall turn hand.
+     *
+     * Entries are packed into bits each from the least significant bit of table, and at least
+     * 8 bytes follow the last, so hand_iso_project reads any entry with one load.
+     */
+    typedef struct hand_iso_projection {
+        hand_recall recall;     // the recall type of the entries
+        int street;
+        uint64_t size;          // number of perfect recall indices of the street
+        uint32_t bits;          // width of each entry
+        const uint8_t *table;
+        bool mapped;            // the table is mapped from a file
+    } hand_iso_projection;
+
+    /**
+     * Build the projection table of a street in parallel.
+     *
+     * Unpacked entries take 32 bits. Packed entries take as many bits as the largest index
+     * of the recall type's street needs: 27 for the imperfect recall river, which makes its
+     * table 8.2 GB instead of 9.7 GB.
+     *
+     * @param recall The recall type of the entries, whose hands must hold the same cards as
+     *        perfect recall hands of the street
+     * @param street The betting round (0=preflop, 1=flop, 2=turn, 3=river)
+     * @param packed Pack the entries into as few bits as they need
+     * @param threads Number of workers, or 0 for one per hardware thread
+     * @return The table, or nullptr if the recall type's hands differ or out of memory
+     */
+    const hand_iso_projection *hand_iso_projection_build(hand_recall recall, int street, bool packed, int threads);
+
+    /**
+     * Save a projection table to a file, which is versioned and checksummed.
+     *
+     * @param projection The table
+     * @param path File to create or overwrite
+     * @return true if the file was written
+     */
+    bool hand_iso_projection_save(const hand_iso_projection *projection, const char *path);
+
+    /**
+     * Map a projection table saved by hand_iso_projection_save read only, so processes using
+     * the same file share its pages. The table is packed if it was saved packed.
+     *
+     * @param recall The recall type the table was built for
+     * @param street The street the table was built for
+     * @param path File to map
+     * @param verify Check the file's checksum, which reads the whole file
+     * @return The table, or nullptr if the file is missing or was built for another street
+     */
+    const hand_iso_projection *hand_iso_projection_map(hand_recall recall, int street, const char *path, bool verify);
+
+    /**
+     * Free a projection table, unmapping it if it was mapped.
+     *
+     * @param projection The table
+     */
+    void hand_iso_projection_free(const hand_iso_projection *projection);
+
+    /**
+     * Get the size of a projection table.
+     *
+     * @param projection The table
+     * @return The size of the table in bytes
+     */
+    static inline uint64_t hand_iso_projection_memory_usage(const hand_iso_projection *projection){
+        return (projection->size * projection->bits + 7) / 8 + 8;
+    }
+
+    /**
+     * Get the recall type's index of the hand of a perfect recall index.
+     *
+     * @param projection The table
+     * @param index A perfect recall index of the table's street
+     * @return The recall type's index on the same street
+     */
+    static inline uint64_t hand_iso_project(const hand_iso_projection *projection, uint64_t index){
+        const uint64_t bit = index * projection->bits;
+        uint64_t word;
+        memcpy(&word, projection->table + (bit >> 3), sizeof(word));
+        return word >> (bit & 7) & (((uint64_t)1 << projection->bits) - 1);
+    }
+
+    // ========== Memory ==========
+
+    /**
+     * Get the memory used by the lookup tables of every recall type and by the board
+     * major layout.
+     *
+     * Builds any recall type or layout that is not in use yet. Tables shared from a mapped
+     * file are counted as well.
+     *
+     * @return The size of all lookup tables in bytes
+     */
+    uint64_t hand_isomorphism_memory_usage(void);
+
+    // ========== Table Files ==========
+
+    /**
+     * Save the lookup tables of every recall type to a file.
+     *
+     * The file is versioned and checksummed. It is only valid for builds of this
+     * library with the same version and byte order.
+     *
+     * @param path File to create or overwrite
+     * @return true if the file was written
+     */
+    bool hand_isomorphism_save_tables(const char *path);
+
+    /**
+     * Use the lookup tables in a file written by hand_isomorphism_save_tables.
+     *
+     * The file is mapped read only, so processes using the same file share its pages
+     * and skip building the tables. Call this before any other function in this
+     * header; recall types already in use keep their own tables.
+     *
+     * @param path File to map
+     * @param verify Check the file's checksum, which reads the whole file
+     * @return true if the file was mapped
+     */
+    bool hand_isomorphism_map_tables(const char *path, bool verify);
+
+    // ========== CPU Dispatch ==========
+
+    /**
+     * Get the instruction set flavour of the indexing kernels in use.
+     *
+     * The kernels are compiled for several flavours and the best one the cpu
+     * supports is selected once when the library is loaded.
+     *
+     * @return One of "avx512", "avx2", "popcnt" or "generic"
+     */
+    const char *hand_isomorphism_kernels(void);
+
+    /**
+     * Use another instruction set flavour of the indexing kernels, such as to
+     * compare them. Not safe while other threads are indexing.
+     *
+     * @param name A name returned by hand_isomorphism_kernels
+     * @return false if there is no such flavour or the cpu does not support it
+     */
+    bool hand_isomorphism_use_kernels(const char *name);
+
 }
\ No newline at end of file
@@ -0,0 +1,65 @@
+/**
+ * hand_isomorphism.hpp
+ *
+ * Compile time indexers for the streets of a hand_iso_ctx. A street's indexer is built
+ * once from the context and its index functions inline into the caller, with no call
+ * into the library per hand:
+ *
+ *     const hand_iso_ctx *ctx = hand_iso_ctx_create(PERFECT_RECALL);
+ *     const auto river = hand_iso::street_indexer<PERFECT_RECALL, 3>(ctx);
+ *     uint64_t index = river.index_last(cards);
+ *
+ * The indexers are hand_iso::Indexer from detail/hand_indexer.hpp, and produce the same
+ * indices as the functions of hand_isomorphism.h.
+ */
+
+#pragma once
+
+#include <cassert>
+#include <tuple>
+
+#include "hand_isomorphism.h"
+#include "hand_isomorphism/detail/hand_indexer.hpp"
+
+namespace hand_iso{
+
+// Round shape of each street of a recall type.
+template <hand_recall Recall>
+struct RecallShape;
+
+template <>
+struct RecallShape<IMPERFECT_RECALL>{
+    using Streets = std::tuple<Indexer<2>, Indexer<2,3>, Indexer<2,4>, Indexer<2,5>>;
+};
+
+template <>
+struct RecallShape<PERFECT_RECALL>{
+    using Streets = std::tuple<Indexer<2>, Indexer<2,3>, Indexer<2,3,1>, Indexer<2,3,1,1>>;
+};
+
+template <>
+struct RecallShape<FLOP_RECALL>{
+    using Streets = std::tuple<Indexer<2>, Indexer<2,3>, Indexer<2,3,1>, Indexer<2,3,2>>;
+};
+
+template <>
+struct RecallShape<BOARD_IMPERFECT_RECALL>{
+    using Streets = std::tuple<Indexer<1>, Indexer<3>, Indexer<4>, Indexer<5>>;
+};
+
+template <>
+struct RecallShape<BOARD_FIRST_RECALL>{
+    using Streets = std::tuple<Indexer<2>, Indexer<3,2>, Indexer<4,2>, Indexer<5,2>>;
+};
+
+template <hand_recall Recall, int Street>
+using StreetIndexer = std::tuple_element_t<Street, typename RecallShape<Recall>::Streets>;
+
+// The compile time indexer of a street of a context, valid as long as the context.
+template <hand_recall Recall, int Street>
+StreetIndexer<Recall, Street> street_indexer(const hand_iso_ctx *ctx){
+    assert(ctx->recall == Recall);
+    return StreetIndexer<Recall, Street>(ctx->streets[Street].indexer);
+}
+
+}  // namespace hand_iso
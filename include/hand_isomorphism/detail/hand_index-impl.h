@@ -0,0 +1,69 @@
+/**
+ * hand_index-impl.h
+ * 
+ * @author Kevin Waugh (waugh@cs.cmu.edu)
+ * @date April 13, 2013
+ */
+
+#ifndef _HAND_INDEX_IMPL_H_
+#define _HAND_INDEX_IMPL_H_
+
+/* everything indexing a round needs to know about a permutation, in a single 8 byte load */
+struct hand_index_permutation_s {
+  hand_index_t offset:56; /* configuration_to_offset of the permutation's configuration */
+  hand_index_t pi:5;      /* index into the suit permutations */
+  hand_index_t equal:3;   /* configuration_to_equal of the configuration */
+};
+
+struct hand_indexer_s {
+  uint8_t cards_per_round[HAND_INDEX_MAX_ROUNDS], round_start[HAND_INDEX_MAX_ROUNDS];
+  uint32_t rounds, configurations[HAND_INDEX_MAX_ROUNDS], permutations[HAND_INDEX_MAX_ROUNDS];
+  hand_index_t round_size[HAND_INDEX_MAX_ROUNDS];
+
+  uint32_t * configuration_to_equal[HAND_INDEX_MAX_ROUNDS];
+  hand_index_permutation_t * permutation_to_record[HAND_INDEX_MAX_ROUNDS];
+  uint32_t (* configuration[HAND_INDEX_MAX_ROUNDS])[HAND_INDEX_SUITS];
+  uint32_t (* configuration_to_suit_size[HAND_INDEX_MAX_ROUNDS])[HAND_INDEX_SUITS];
+  hand_index_t * configuration_to_offset[HAND_INDEX_MAX_ROUNDS];
+  uint32_t * configuration_directory[HAND_INDEX_MAX_ROUNDS], directory_shift[HAND_INDEX_MAX_ROUNDS]; /* first configuration of each index >> directory_shift */
+
+  bool mapped; /* tables live in an image used by hand_index_map or hand_index_map_memory */
+};
+
+struct hand_indexer_state_s {
+  uint32_t suit_index[HAND_INDEX_SUITS];
+  uint32_t suit_multiplier[HAND_INDEX_SUITS];
+  uint32_t round, permutation_index, permutation_multiplier;
+  uint32_t used_ranks[HAND_INDEX_SUITS];
+};
+
+struct hand_unindex_iterator_s {
+  const hand_indexer_t * indexer;
+  uint32_t round, groups;
+  hand_index_t index, configuration_end;
+  bool decoded;
+
+  uint8_t group_start[HAND_INDEX_SUITS+1];
+  uint32_t group_limit[HAND_INDEX_SUITS], multiset[HAND_INDEX_SUITS], suit_index[HAND_INDEX_SUITS];
+  hand_index_t group_size[HAND_INDEX_SUITS], group_index[HAND_INDEX_SUITS];
+
+  uint8_t suit_cards[HAND_INDEX_SUITS][HAND_INDEX_MAX_ROUNDS], location[HAND_INDEX_SUITS][HAND_INDEX_MAX_ROUNDS];
+  uint16_t radix[HAND_INDEX_SUITS][HAND_INDEX_MAX_ROUNDS], digits[HAND_INDEX_SUITS][HAND_INDEX_MAX_ROUNDS];
+  uint8_t cards[HAND_INDEX_CARDS]; /* the canonical hand of index */
+};
+
+struct hand_index_tables_s {
+  const uint32_t (* nCr_ranks)[HAND_INDEX_RANKS+1], * rank_set_to_index, (* suit_permutations)[HAND_INDEX_SUITS];
+};
+
+/* canonical hands order a group of k equal suits by suit index, largest first, except that a
+ * tail of two or four suits holding a single 1 is ordered 0, 1, 0, ..., as the floating point
+ * decode of the original hand_unindex wrote it.  given a group's suit indices in decreasing
+ * order, the position of the 1 that moves one place later, or k if none does.  every consumer
+ * of the canonical order applies the rule through here. */
+static inline uint32_t hand_index_group_tail(const uint32_t suit_index[], uint32_t k) {
+  uint32_t last = k-1; for(; last > 0 && !suit_index[last]; --last) {}
+  return suit_index[last] == 1 && (k-last == 2 || k-last == 4) ? last : k;
+}
+
+#endif /* _HAND_INDEX_IMPL_H_ */
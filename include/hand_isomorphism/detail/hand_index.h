@@ -0,0 +1,485 @@
+/**
+ * hand_index.h
+ *
+ * @author Kevin Waugh (waugh@cs.cmu.edu)
+ * @date April 13, 2013
+ * 
+ * map poker hands to an index shared by all isomorphic hands, and
+ * map an index to a canonical poker hand
+ */
+
+#ifndef _HAND_INDEX_H_
+#define _HAND_INDEX_H_
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/* the deck of deck.h, under names that do not clash with the includer's */
+#define HAND_INDEX_SUITS        4
+#define HAND_INDEX_RANKS       13
+#define HAND_INDEX_CARDS       52
+
+#define HAND_INDEX_MAX_ROUNDS   8
+#define HAND_INDEX_BATCH_LANES 16
+#define HAND_INDEX_NO_SUCCESSOR UINT32_MAX
+
+typedef uint64_t hand_index_t;
+typedef struct hand_indexer_s hand_indexer_t;
+typedef struct hand_index_permutation_s hand_index_permutation_t;
+typedef struct hand_indexer_state_s hand_indexer_state_t;
+typedef struct hand_unindex_iterator_s hand_unindex_iterator_t;
+typedef struct hand_index_tables_s hand_index_tables_t;
+
+#define PRIhand_index        PRIu64
+
+/* the indexing kernels are compiled once per instruction set flavour, most capable first,
+ * and the best flavour the cpu supports is selected when the library is loaded.  each entry
+ * is X(name, attributes of the flavour's entry points, whether it uses pext and pdep).  the
+ * entry points are flattened so that the kernels inline into code built for their target. */
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define HAND_INDEX_DISPATCH
+#define HAND_INDEX_FLAVOURS(X) \
+  X(avx512,  __attribute__((target("popcnt,sse4.2,avx2,bmi,bmi2,lzcnt,avx512f,avx512bw,avx512dq,avx512vl"), flatten)), true) \
+  X(avx2,    __attribute__((target("popcnt,sse4.2,avx2,bmi,bmi2,lzcnt"), flatten)), true) \
+  X(popcnt,  __attribute__((target("popcnt,sse4.2"), flatten)), false) \
+  X(generic, __attribute__((flatten)), false)
+#else
+#define HAND_INDEX_FLAVOURS(X) \
+  X(generic, , false)
+#endif
+
+/**
+ * Compute the global lookup tables.  Does nothing if they are already available, either
+ * from an earlier call or from a file mapped by hand_index_map.
+ */
+void hand_index_ctor();
+
+/**
+ * @returns name of the instruction set flavour of the indexing kernels in use, one of
+ * the names in HAND_INDEX_FLAVOURS
+ */
+const char * hand_index_kernels();
+
+/**
+ * Use another instruction set flavour of the indexing kernels, such as to compare them.
+ * Not safe while other threads are indexing.
+ *
+ * @param name a name in HAND_INDEX_FLAVOURS
+ * @returns false if there is no such flavour or the cpu does not support it
+ */
+bool hand_index_use_kernels(const char * name);
+
+/**
+ * Initialize a hand indexer.  This generates a number of lookup tables and is relatively
+ * expensive compared to indexing a hand.
+ *
+ * @param rounds number of rounds
+ * @param cards_per_round number of cards in each round
+ * @param indexer 
+ */
+bool hand_indexer_init(uint32_t rounds, const uint8_t cards_per_round[], hand_indexer_t * indexer);
+
+/**
+ * Free a hand indexer.
+ *
+ * @param indexer
+ */
+void hand_indexer_free(hand_indexer_t * indexer);
+
+/**
+ * The global lookup tables used to index a round, for indexing kernels compiled outside
+ * this file.  Only valid once hand_index_ctor has run or a file has been mapped.
+ *
+ * @param tables
+ */
+void hand_index_tables(hand_index_tables_t * tables);
+
+/**
+ * @returns bytes used by the global lookup tables
+ */
+size_t hand_index_memory();
+
+/**
+ * @param indexer
+ * @returns bytes used by the indexer's lookup tables
+ */
+size_t hand_indexer_memory(const hand_indexer_t * indexer);
+
+/**
+ * @param indexer
+ * @param round 
+ * @returns size of index for hands on round
+ */
+hand_index_t hand_indexer_size(const hand_indexer_t * indexer, uint32_t round);
+
+/**
+ * Initialize a hand index state.  This is used for incrementally indexing a hand as
+ * new rounds are dealt and determining if a hand is canonical.
+ *
+ * @param indexer
+ * @param state
+ */
+void hand_indexer_state_init(const hand_indexer_t * indexer, hand_indexer_state_t * state);
+
+/**
+ * Index a hand on every round.  This does the permutation lookup and sort of every round, so
+ * prefer hand_index_last when only the last round's index is needed.
+ *
+ * @param indexer
+ * @param cards
+ * @param indices
+ * @returns hand's index on the last round
+ */
+hand_index_t hand_index_all(const hand_indexer_t * indexer, const uint8_t cards[], hand_index_t indices[]);
+
+/**
+ * Index a hand on the last round.  The earlier rounds only accumulate the per suit state,
+ * and the permutation lookup and sort run once, on the last round.
+ *
+ * @param indexer
+ * @param cards
+ * @returns hand's index on the last round
+ */
+hand_index_t hand_index_last(const hand_indexer_t * indexer, const uint8_t cards[]);
+
+/**
+ * Incrementally index the next round.
+ * 
+ * @param indexer
+ * @param cards the cards for the next round only!
+ * @param state
+ * @returns the hand's index at the latest round
+ */
+hand_index_t hand_index_next_round(const hand_indexer_t * indexer, const uint8_t cards[], hand_indexer_state_t * state);
+
+/**
+ * Incrementally index the next round from its cards grouped by suit.
+ *
+ * @param indexer
+ * @param ranks the rank set of each suit dealt in the next round only
+ * @param state
+ * @returns the hand's index at the latest round
+ */
+hand_index_t hand_index_next_round_ranks(const hand_indexer_t * indexer, const uint32_t ranks[HAND_INDEX_SUITS], hand_indexer_state_t * state);
+
+/**
+ * Incrementally index the next round from a card mask, which has bit deck_make_card(suit, rank)
+ * set for each card dealt in the next round only.
+ *
+ * @param indexer
+ * @param cards
+ * @param state
+ * @returns the hand's index at the latest round
+ */
+hand_index_t hand_index_next_round_mask(const hand_indexer_t * indexer, uint64_t cards, hand_indexer_state_t * state);
+
+/**
+ * Index a hand given as one card mask per round on the last round.
+ *
+ * @param indexer
+ * @param cards the card mask of each round
+ * @returns hand's index on the last round
+ */
+hand_index_t hand_index_last_masks(const hand_indexer_t * indexer, const uint64_t cards[]);
+
+/**
+ * Index a batch of hands on the last round.  Hands are stored back to back, each
+ * holding every card dealt through the last round.  Blocks of HAND_INDEX_BATCH_LANES
+ * hands are indexed in lockstep: the table lookups of a block are independent so their
+ * cache misses overlap, and the sorting network is branch free across lanes.
+ *
+ * @param indexer
+ * @param cards n hands of cards
+ * @param n number of hands
+ * @param indices receives each hand's index on the last round
+ */
+void hand_index_batch(const hand_indexer_t * indexer, const uint8_t cards[], size_t n, hand_index_t indices[]);
+
+/**
+ * Relabel the suits of a hand to give the canonical hand of its index on the last round,
+ * without computing the index.  Hands are isomorphic exactly when their canonical hands
+ * are equal.
+ *
+ * @param indexer
+ * @param cards
+ * @param canonical_cards receives the canonical hand, as hand_unindex writes it
+ * @param suit_permutation receives the canonical suit of each suit of the hand.  suits
+ *        with the same cards can be swapped, and get one of the canonical suits they share
+ */
+void hand_canonicalize(const hand_indexer_t * indexer, const uint8_t cards[], uint8_t canonical_cards[], uint8_t suit_permutation[HAND_INDEX_SUITS]);
+
+/**
+ * Canonicalize a batch of hands, stored back to back as for hand_index_batch.
+ *
+ * @param indexer
+ * @param cards n hands of cards
+ * @param n number of hands
+ * @param canonical_cards receives n canonical hands
+ * @param suit_permutations receives HAND_INDEX_SUITS entries for each hand
+ */
+void hand_canonicalize_batch(const hand_indexer_t * indexer, const uint8_t cards[], size_t n, uint8_t canonical_cards[], uint8_t suit_permutations[]);
+
+/**
+ * Recover the canonical hand from a particular index.
+ *
+ * @param indexer
+ * @param round
+ * @param index
+ * @param cards
+ * @returns true if successful
+ */
+bool hand_unindex(const hand_indexer_t * indexer, uint32_t round, hand_index_t index, uint8_t cards[]);
+
+/**
+ * Recover the canonical hand from a particular index as one card mask per round.
+ *
+ * @param indexer
+ * @param round
+ * @param index
+ * @param cards receives the card mask of each round through round
+ * @returns true if successful
+ */
+bool hand_unindex_masks(const hand_indexer_t * indexer, uint32_t round, hand_index_t index, uint64_t cards[]);
+
+/**
+ * Recover the canonical hands from many indices.  Hands are written back to back,
+ * each holding every card dealt through round.
+ *
+ * @param indexer
+ * @param round
+ * @param indices
+ * @param n number of indices
+ * @param cards receives n hands
+ * @returns true if every index was valid
+ */
+bool hand_unindex_batch(const hand_indexer_t * indexer, uint32_t round, const hand_index_t indices[], size_t n, uint8_t cards[]);
+
+/**
+ * The index on an earlier round of the hand whose index on round is index.  Each suit
+ * index holds a digit per round, so the earlier round's suit indices are their low digits
+ * and no cards are decoded.
+ *
+ * @param indexer
+ * @param round
+ * @param index
+ * @param to_round a round no later than round
+ * @param projected receives the index on to_round
+ * @returns true if successful
+ */
+bool hand_index_project(const hand_indexer_t * indexer, uint32_t round, hand_index_t index, uint32_t to_round, hand_index_t * projected);
+
+/**
+ * Project many indices, as hand_index_project.
+ *
+ * @param indexer
+ * @param round
+ * @param indices
+ * @param n number of indices
+ * @param to_round
+ * @param projected receives n indices, UINT64_MAX for each invalid one
+ * @returns true if every index was valid
+ */
+bool hand_index_project_batch(const hand_indexer_t * indexer, uint32_t round, const hand_index_t indices[], size_t n, uint32_t to_round, hand_index_t projected[]);
+
+/**
+ * Start walking the canonical hands of a round in index order.  The iterator's cards
+ * hold the canonical hand of its index, as written by hand_unindex.  Consecutive indices
+ * usually share a configuration and differ in few suits, so moving the iterator only
+ * decodes the suits that changed.
+ *
+ * @param indexer
+ * @param round
+ * @param index
+ * @param iterator
+ * @returns true if successful
+ */
+bool hand_unindex_iterator_init(const hand_indexer_t * indexer, uint32_t round, hand_index_t index, hand_unindex_iterator_t * iterator);
+
+/**
+ * Move an iterator to the next index.
+ *
+ * @param iterator
+ * @returns false if the iterator was on the round's last index
+ */
+bool hand_unindex_iterator_next(hand_unindex_iterator_t * iterator);
+
+/**
+ * Move an iterator forward by a number of indices.
+ *
+ * @param iterator
+ * @param stride
+ * @returns false if that moves the iterator past the round's last index
+ */
+bool hand_unindex_iterator_advance(hand_unindex_iterator_t * iterator, hand_index_t stride);
+
+/**
+ * Receives one hand of an index's orbit from hand_expand, laid out as hand_unindex writes
+ * it.  The cards are only valid during the call.
+ */
+typedef void (*hand_expand_callback_t)(const uint8_t cards[], void * data);
+
+/**
+ * The number of hands whose index on a round is each of a range of indices, as counted by
+ * hand_expand_count.  No index has more than 24, one for each suit relabelling.  Suits are
+ * only compared within their configuration's groups of equal suits, so runs of indices whose
+ * groups hold no repeated suits are filled at once.
+ *
+ * @param indexer
+ * @param round
+ * @param first the first index of the range
+ * @param n number of indices
+ * @param multiplicities receives n multiplicities
+ * @returns true if every index was valid
+ */
+bool hand_multiplicities(const hand_indexer_t * indexer, uint32_t round, hand_index_t first, size_t n, uint8_t multiplicities[]);
+
+/**
+ * Count the hands whose index on a round is index: the distinct suit relabellings of its
+ * canonical hand, each counted once whatever the order of the cards within a round.
+ *
+ * @param indexer
+ * @param round
+ * @param index
+ * @returns the number of hands, or 0 if index is invalid
+ */
+hand_index_t hand_expand_count(const hand_indexer_t * indexer, uint32_t round, hand_index_t index);
+
+/**
+ * Visit every hand whose index on a round is index, as counted by hand_expand_count.  Only
+ * the distinct suit relabellings of the canonical hand are visited, so the cost is
+ * proportional to the size of the orbit.
+ *
+ * @param indexer
+ * @param round
+ * @param index
+ * @param callback called with each hand
+ * @param data passed to callback
+ * @returns the number of hands visited, or 0 if index is invalid
+ */
+hand_index_t hand_expand(const hand_indexer_t * indexer, uint32_t round, hand_index_t index, hand_expand_callback_t callback, void * data);
+
+/**
+ * The index of each hand extended by each card.  next must deal one card more than
+ * indexer, either on a round of its own or on one of indexer's rounds, after that round's
+ * cards, and have fewer than HAND_INDEX_NO_SUCCESSOR indices.
+ *
+ * @param indexer
+ * @param next
+ * @param cards n hands of indexer's last round, back to back
+ * @param n number of hands
+ * @param successors receives HAND_INDEX_CARDS entries for each hand: the index on next's last
+ *        round of the hand with that card, or HAND_INDEX_NO_SUCCESSOR for cards in the hand
+ * @returns true if next extends indexer by one card
+ */
+bool hand_successors(const hand_indexer_t * indexer, const hand_indexer_t * next, const uint8_t cards[], size_t n, uint32_t successors[]);
+
+/**
+ * Save the global lookup tables and a number of hand indexers to a versioned, checksummed
+ * file that hand_index_map can share read only between processes.
+ *
+ * @param path
+ * @param count number of indexers
+ * @param indexers
+ * @returns true if successful
+ */
+bool hand_index_save(const char * path, uint32_t count, const hand_indexer_t * const indexers[]);
+
+/**
+ * Map a file written by hand_index_save.  The indexers point into the read only mapping,
+ * which is shared through the page cache and never unmapped.  If hand_index_ctor has not
+ * run, the file also provides the global lookup tables and hand_index_ctor need not be
+ * called.
+ *
+ * @param path
+ * @param verify check the checksum, which reads the whole file
+ * @param capacity size of indexers
+ * @param indexers receives the indexers in the order they were saved
+ * @param count receives the number of indexers
+ * @returns true if successful
+ */
+bool hand_index_map(const char * path, bool verify, uint32_t capacity, hand_indexer_t * indexers, uint32_t * count);
+
+/**
+ * Use an image of a file written by hand_index_save that is already in memory, such as
+ * one compiled into the program.  The image must be 8 byte aligned and outlive every
+ * use of the library.  See hand_index_map.
+ *
+ * @param data
+ * @param size bytes in data
+ * @param verify check the checksum
+ * @param capacity size of indexers
+ * @param indexers receives the indexers in the order they were saved
+ * @param count receives the number of indexers
+ * @returns true if successful
+ */
+bool hand_index_map_memory(const void * data, size_t size, bool verify, uint32_t capacity, hand_indexer_t * indexers, uint32_t * count);
+
+/**
+ * Save the successors of every index of indexer's last round, as filled by hand_successors,
+ * to a versioned, checksummed file.
+ *
+ * @param path
+ * @param indexer
+ * @param next
+ * @param successors
+ * @returns true if successful
+ */
+bool hand_successors_save(const char * path, const hand_indexer_t * indexer, const hand_indexer_t * next, const uint32_t successors[]);
+
+/**
+ * Map a file written by hand_successors_save for the same indexers read only.
+ *
+ * @param path
+ * @param indexer
+ * @param next
+ * @param verify check the file's checksum, which reads the whole file
+ * @returns the successors, or NULL if the file could not be mapped or is for other indexers
+ */
+const uint32_t * hand_successors_map(const char * path, const hand_indexer_t * indexer, const hand_indexer_t * next, bool verify);
+
+/**
+ * Unmap successors returned by hand_successors_map.
+ *
+ * @param successors
+ */
+void hand_successors_unmap(const uint32_t successors[]);
+
+/**
+ * Save a projection table to a file like hand_successors_save.  The table holds an index of
+ * target's last round for every index of indexer's last round, packed into bits each from
+ * the least significant bit of the first byte.
+ *
+ * @param path
+ * @param indexer
+ * @param target
+ * @param bits width of the entries
+ * @param projections
+ * @returns true if successful
+ */
+bool hand_projections_save(const char * path, const hand_indexer_t * indexer, const hand_indexer_t * target, uint32_t bits, const void * projections);
+
+/**
+ * Map a file written by hand_projections_save for the same indexers read only.  At least 8
+ * bytes follow the last entry, so every entry can be read with one 8 byte load.
+ *
+ * @param path
+ * @param indexer
+ * @param target
+ * @param bits receives the width of the entries
+ * @param verify check the file's checksum, which reads the whole file
+ * @returns the projections, or NULL if the file could not be mapped or is for other indexers
+ */
+const void * hand_projections_map(const char * path, const hand_indexer_t * indexer, const hand_indexer_t * target, uint32_t * bits, bool verify);
+
+/**
+ * Unmap projections returned by hand_projections_map.
+ *
+ * @param projections
+ */
+void hand_projections_unmap(const void * projections);
+
+#include "hand_index-impl.h"
+
+
+#endif /* _HAND_INDEX_H_ */
@@ -0,0 +1,472 @@
+/**
+ * hand_isomorphism/detail/hand_indexer.hpp
+ *
+ * Hand indexer with the round shape fixed at compile time. hand_iso::Indexer<2,3,1,1>
+ * wraps a hand_indexer_t built for the same shape and produces the same indices, but
+ * every card and suit loop has a constant bound, intermediate rounds compile down to the
+ * per-suit bookkeeping they need, and the group sorting network is picked once per hand
+ * from the configuration's equal suit mask instead of branching suit by suit.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#ifdef __BMI2__
+#include <immintrin.h>
+#endif
+
+// The per round steps of a hand are forced inline so that a call of index_last compiles to
+// one straight line kernel wherever it is inlined, not only in the library's flattened
+// entry points.
+#if defined(__GNUC__) || defined(__clang__)
+#define HAND_ISO_ALWAYS_INLINE inline __attribute__((always_inline))
+#elif defined(_MSC_VER)
+#define HAND_ISO_ALWAYS_INLINE __forceinline
+#else
+#define HAND_ISO_ALWAYS_INLINE inline
+#endif
+
+extern "C"{
+#include "hand_index.h"
+}
+
+namespace hand_iso{
+
+namespace detail{
+
+inline uint32_t popcount(uint32_t x){
+#ifdef _MSC_VER
+    return __popcnt(x);
+#else
+    return __builtin_popcount(x);
+#endif
+}
+
+// Index of the lowest set bit, which x must have.
+inline uint32_t ctz64(uint64_t x){
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward64(&index, x);
+    return index;
+#else
+    return __builtin_ctzll(x);
+#endif
+}
+
+// The card layout of deck.h, which is internal to the library: a card is rank << 2 | suit,
+// and a card mask has bit card set for each card.
+inline uint32_t card_suit(uint8_t card){
+    return card & 3;
+}
+
+inline uint32_t card_rank(uint8_t card){
+    return card >> 2;
+}
+
+inline uint8_t make_card(uint32_t suit, uint32_t rank){
+    return static_cast<uint8_t>(rank << 2 | suit);
+}
+
+constexpr uint64_t suit_mask = 0x1111111111111ull;
+
+// The rank set of a suit in a card mask, as deck_mask_get_ranks.
+inline uint32_t mask_ranks(uint64_t mask, uint32_t suit){
+#ifdef __BMI2__
+    return static_cast<uint32_t>(_pext_u64(mask, suit_mask << suit));
+#else
+    uint64_t x = mask >> suit & suit_mask;
+    x = (x | x >> 3) & 0x0303030303030303ull;
+    x = (x | x >> 6) & 0x000f000f000f000full;
+    x = (x | x >> 12) & 0x000000ff000000ffull;
+    return static_cast<uint32_t>(x | x >> 24) & 0xffff;
+#endif
+}
+
+// Ranks renumbered among the ranks not in used, which ranks must not intersect, as
+// deck_shift_ranks.
+inline uint32_t shift_ranks(uint32_t ranks, uint32_t used){
+#ifdef __BMI2__
+    return _pext_u32(ranks, ~used);
+#else
+    uint32_t shifted = 0;
+    for (uint32_t set = ranks; set; set &= set - 1)
+    {
+        uint32_t rank_bit = set & (0u - set);
+        shifted |= rank_bit >> popcount((rank_bit - 1) & used);
+    }
+    return shifted;
+#endif
+}
+
+// nCr(n, K) for the groups of up to four equal suits, matching hand_index.c's nCr_groups.
+template <uint32_t K>
+constexpr hand_index_t group_binomial(hand_index_t n){
+    static_assert(K >= 1 && K <= HAND_INDEX_SUITS, "groups hold one to four suits");
+    if constexpr (K == 1) {
+        return n;
+    } else if constexpr (K == 2) {
+        return n * (n - 1) / 2;
+    } else if constexpr (K == 3) {
+        return n * (n - 1) / 2 * (n - 2) / 3;
+    } else {
+        return n * (n - 1) / 2 * (n - 2) / 3 * (n - 3) / 4;
+    }
+}
+
+// Number of suits in the group of equal suits starting at suit I. Bit i-1 of the mask
+// is set when suit i is equal to suit i-1.
+template <uint32_t Mask, uint32_t I>
+constexpr uint32_t group_size(){
+    uint32_t size = 1;
+    while (I + size < HAND_INDEX_SUITS && (Mask >> (I + size - 1) & 1)) {
+        size++;
+    }
+    return size;
+}
+
+inline void compare_swap(hand_index_t suit_index[HAND_INDEX_SUITS], uint32_t u, uint32_t v){
+    hand_index_t a = suit_index[u], b = suit_index[v];
+    suit_index[u] = std::min(a, b);
+    suit_index[v] = std::max(a, b);
+}
+
+}  // namespace detail
+
+template <uint8_t... Cards>
+class Indexer{
+public:
+    static constexpr uint32_t rounds = sizeof...(Cards);
+    static_assert(rounds >= 1 && rounds <= HAND_INDEX_MAX_ROUNDS, "an indexer has one to HAND_INDEX_MAX_ROUNDS rounds");
+
+    static constexpr std::array<uint8_t, rounds> cards_per_round = {Cards...};
+    static constexpr uint32_t cards = (0 + ... + Cards);
+    static constexpr std::array<uint32_t, rounds> round_start = []{
+        std::array<uint32_t, rounds> start{};
+        for (uint32_t round = 0, next = 0; round < rounds; next += cards_per_round[round++])
+        {
+            start[round] = next;
+        }
+        return start;
+    }();
+
+    using State = hand_indexer_state_t;
+
+    static std::vector<uint8_t> shape(){
+        return {Cards...};
+    }
+
+    // The indexer must have been built for this shape, and hand_index_ctor must have run.
+    explicit Indexer(const hand_indexer_t *indexer):
+        indexer(indexer){
+        assert(indexer->rounds == rounds);
+        assert(std::equal(cards_per_round.begin(), cards_per_round.end(), indexer->cards_per_round));
+        hand_index_tables(&tables);
+        for (uint32_t round = 0; round < rounds; round++)
+        {
+            permutation_to_record[round] = indexer->permutation_to_record[round];
+        }
+    }
+
+    const hand_indexer_t *get() const{
+        return indexer;
+    }
+
+    hand_index_t size(uint32_t round = rounds - 1) const{
+        return hand_indexer_size(indexer, round);
+    }
+
+    static void state_init(State *state){
+        *state = State{};
+        state->permutation_multiplier = 1;
+        for (uint32_t i = 0; i < HAND_INDEX_SUITS; i++)
+        {
+            state->suit_multiplier[i] = 1;
+        }
+    }
+
+    // The earlier rounds' indices are not needed, so those rounds only accumulate the
+    // per suit state, and the permutation lookup and sort run once, on the last round.
+    HAND_ISO_ALWAYS_INLINE hand_index_t index_last(const uint8_t *hand) const{
+        State state;
+        state_init(&state);
+        uint32_t rank_sets[rounds][HAND_INDEX_SUITS];
+        accumulate_rounds<0>(hand, &state, rank_sets);
+        return lookup<rounds - 1>(&state);
+    }
+
+    // Relabel the suits of a hand to give the canonical hand of its index on the last round,
+    // as hand_canonicalize: the suits in the permutation record's order, each group of equal
+    // suits sorted by suit index as hand_unindex decodes it.
+    HAND_ISO_ALWAYS_INLINE void canonicalize(const uint8_t *hand, uint8_t *canonical, uint8_t suit_permutation[HAND_INDEX_SUITS]) const{
+        State state;
+        state_init(&state);
+        uint32_t rank_sets[rounds][HAND_INDEX_SUITS];
+        accumulate_rounds<0>(hand, &state, rank_sets);
+
+        const hand_index_permutation_t &record = permutation_to_record[rounds - 1][state.permutation_index];
+        const uint32_t *pi = tables.suit_permutations[record.pi];
+        const uint32_t equal = record.equal;
+        uint32_t suits[HAND_INDEX_SUITS];
+        for (uint32_t i = 0; i < HAND_INDEX_SUITS; i++)
+        {
+            suits[i] = pi[i];
+            for (uint32_t j = i; j > 0 && (equal >> (j - 1) & 1) && state.suit_index[suits[j - 1]] < state.suit_index[suits[j]]; j--)
+            {
+                std::swap(suits[j], suits[j - 1]);
+            }
+        }
+
+        for (uint32_t i = 0; i < HAND_INDEX_SUITS;)
+        {
+            uint32_t j = i + 1;
+            while (j < HAND_INDEX_SUITS && (equal >> (j - 1) & 1)) {
+                j++;
+            }
+            uint32_t group[HAND_INDEX_SUITS];
+            for (uint32_t k = i; k < j; k++)
+            {
+                group[k - i] = state.suit_index[suits[k]];
+            }
+            const uint32_t tail = i + hand_index_group_tail(group, j - i);
+            if (tail < j) {
+                std::swap(suits[tail], suits[tail + 1]);
+            }
+            i = j;
+        }
+
+        for (uint32_t i = 0; i < HAND_INDEX_SUITS; i++)
+        {
+            suit_permutation[suits[i]] = i;
+        }
+        // Each round's cards ordered by canonical suit and then rank are the set bits of its
+        // rank sets packed in canonical suit order, and each round has a fixed card count.
+        for (uint32_t round = 0; round < rounds; round++)
+        {
+            uint64_t packed = 0;
+            for (uint32_t i = 0; i < HAND_INDEX_SUITS; i++)
+            {
+                packed |= uint64_t(rank_sets[round][suits[i]]) << 16 * i;
+            }
+            for (uint32_t k = 0; k < cards_per_round[round]; k++, packed &= packed - 1)
+            {
+                uint32_t bit = detail::ctz64(packed);
+                canonical[round_start[round] + k] = detail::make_card(bit >> 4, bit & 15);
+            }
+        }
+    }
+
+    HAND_ISO_ALWAYS_INLINE hand_index_t index_all(const uint8_t *hand, hand_index_t indices[rounds]) const{
+        State state;
+        state_init(&state);
+        index_rounds<0>(hand, &state, indices);
+        return indices[rounds - 1];
+    }
+
+    // Index the cards dealt on Round, which must be the next round of the state.
+    template <uint32_t Round>
+    HAND_ISO_ALWAYS_INLINE hand_index_t next_round(const uint8_t *round_cards, State *state) const{
+        uint32_t ranks[HAND_INDEX_SUITS], shifted_ranks[HAND_INDEX_SUITS];
+        round_ranks<Round>(round_cards, state, ranks, shifted_ranks);
+        return index_round<Round>(ranks, shifted_ranks, state);
+    }
+
+    // Like next_round, with the cards given as the rank set dealt in each suit.
+    template <uint32_t Round>
+    hand_index_t next_round_ranks(const uint32_t ranks[HAND_INDEX_SUITS], State *state) const{
+        static_assert(Round < rounds, "round out of range");
+        assert(state->round == Round);
+
+        uint32_t shifted_ranks[HAND_INDEX_SUITS];
+        for (uint32_t i = 0; i < HAND_INDEX_SUITS; i++)
+        {
+            shifted_ranks[i] = detail::shift_ranks(ranks[i], state->used_ranks[i]);
+        }
+        return index_round<Round>(ranks, shifted_ranks, state);
+    }
+
+    // Like next_round, with the cards given as a card mask.
+    template <uint32_t Round>
+    hand_index_t next_round_mask(uint64_t round_cards, State *state) const{
+        uint32_t ranks[HAND_INDEX_SUITS];
+        for (uint32_t i = 0; i < HAND_INDEX_SUITS; i++)
+        {
+            ranks[i] = detail::mask_ranks(round_cards, i);
+        }
+        return next_round_ranks<Round>(ranks, state);
+    }
+
+    // Index a hand given as one card mask per round on the last round, as index_last.
+    HAND_ISO_ALWAYS_INLINE hand_index_t index_last_masks(const uint64_t masks[rounds]) const{
+        State state;
+        state_init(&state);
+        accumulate_masks<0>(masks, &state);
+        return lookup<rounds - 1>(&state);
+    }
+
+    // next_round for a round only known at run time.
+    hand_index_t next_round(const uint8_t *round_cards, State *state) const{
+        return dispatch_round(round_cards, state, std::make_integer_sequence<uint32_t, rounds>{});
+    }
+
+private:
+    template <uint32_t Round>
+    HAND_ISO_ALWAYS_INLINE void index_rounds(const uint8_t *hand, State *state, hand_index_t indices[rounds]) const{
+        indices[Round] = next_round<Round>(hand + round_start[Round], state);
+        if constexpr (Round + 1 < rounds) {
+            index_rounds<Round + 1>(hand, state, indices);
+        }
+    }
+
+    template <uint32_t Round>
+    HAND_ISO_ALWAYS_INLINE void accumulate_rounds(const uint8_t *hand, State *state, uint32_t rank_sets[rounds][HAND_INDEX_SUITS]) const{
+        uint32_t shifted_ranks[HAND_INDEX_SUITS];
+        round_ranks<Round>(hand + round_start[Round], state, rank_sets[Round], shifted_ranks);
+        accumulate<Round>(rank_sets[Round], shifted_ranks, state);
+        if constexpr (Round + 1 < rounds) {
+            accumulate_rounds<Round + 1>(hand, state, rank_sets);
+        }
+    }
+
+    template <uint32_t Round>
+    HAND_ISO_ALWAYS_INLINE void accumulate_masks(const uint64_t masks[rounds], State *state) const{
+        uint32_t ranks[HAND_INDEX_SUITS], shifted_ranks[HAND_INDEX_SUITS];
+        for (uint32_t i = 0; i < HAND_INDEX_SUITS; i++)
+        {
+            ranks[i] = detail::mask_ranks(masks[Round], i);
+            shifted_ranks[i] = detail::shift_ranks(ranks[i], state->used_ranks[i]);
+        }
+        accumulate<Round>(ranks, shifted_ranks, state);
+        if constexpr (Round + 1 < rounds) {
+            accumulate_masks<Round + 1>(masks, state);
+        }
+    }
+
+    // The rank set dealt in each suit on Round, and each renumbered among the ranks of
+    // the suit not used on earlier rounds.
+    template <uint32_t Round>
+    HAND_ISO_ALWAYS_INLINE void round_ranks(const uint8_t *round_cards, const State *state,
+                                            uint32_t ranks[HAND_INDEX_SUITS], uint32_t shifted_ranks[HAND_INDEX_SUITS]) const{
+        static_assert(Round < rounds, "round out of range");
+        assert(state->round == Round);
+
+        for (uint32_t i = 0; i < HAND_INDEX_SUITS; i++)
+        {
+            ranks[i] = shifted_ranks[i] = 0;
+        }
+        for (uint32_t i = 0; i < cards_per_round[Round]; i++)
+        {
+            assert(round_cards[i] < HAND_INDEX_CARDS);
+            uint32_t suit = detail::card_suit(round_cards[i]), rank_bit = 1u << detail::card_rank(round_cards[i]);
+            assert(!(ranks[suit] & rank_bit));
+            ranks[suit] |= rank_bit;
+            shifted_ranks[suit] |= rank_bit >> detail::popcount((rank_bit - 1) & state->used_ranks[suit]);
+        }
+    }
+
+    template <uint32_t... Round>
+    hand_index_t dispatch_round(const uint8_t *round_cards, State *state, std::integer_sequence<uint32_t, Round...>) const{
+        assert(state->round < rounds);
+        hand_index_t index = 0;
+        ((state->round == Round && (index = next_round<Round>(round_cards, state), true)) || ...);
+        return index;
+    }
+
+    template <uint32_t Round>
+    HAND_ISO_ALWAYS_INLINE hand_index_t index_round(const uint32_t ranks[HAND_INDEX_SUITS], const uint32_t shifted_ranks[HAND_INDEX_SUITS], State *state) const{
+        accumulate<Round>(ranks, shifted_ranks, state);
+        return lookup<Round>(state);
+    }
+
+    // The per suit state of Round, which only touches the small rank tables.
+    template <uint32_t Round>
+    HAND_ISO_ALWAYS_INLINE void accumulate(const uint32_t ranks[HAND_INDEX_SUITS], const uint32_t shifted_ranks[HAND_INDEX_SUITS], State *state) const{
+        state->round++;
+
+        uint32_t remaining = cards_per_round[Round];
+        for (uint32_t i = 0; i < HAND_INDEX_SUITS; i++)
+        {
+            assert(!(state->used_ranks[i] & ranks[i]));
+            uint32_t used_size = detail::popcount(state->used_ranks[i]), this_size = detail::popcount(ranks[i]);
+            state->suit_index[i] += state->suit_multiplier[i] * tables.rank_set_to_index[shifted_ranks[i]];
+            state->suit_multiplier[i] *= tables.nCr_ranks[HAND_INDEX_RANKS - used_size][this_size];
+            state->used_ranks[i] |= ranks[i];
+
+            if (i < HAND_INDEX_SUITS - 1) {
+                state->permutation_index += state->permutation_multiplier * this_size;
+                state->permutation_multiplier *= remaining + 1;
+                remaining -= this_size;
+            }
+        }
+        assert(remaining == detail::popcount(ranks[HAND_INDEX_SUITS - 1]));
+    }
+
+    // The index on Round of the hand in the state, which must be through Round.
+    template <uint32_t Round>
+    HAND_ISO_ALWAYS_INLINE hand_index_t lookup(const State *state) const{
+        const hand_index_permutation_t &record = permutation_to_record[Round][state->permutation_index];
+        const uint32_t *pi = tables.suit_permutations[record.pi];
+        hand_index_t suit_index[HAND_INDEX_SUITS], suit_multiplier[HAND_INDEX_SUITS];
+        for (uint32_t i = 0; i < HAND_INDEX_SUITS; i++)
+        {
+            suit_index[i] = state->suit_index[pi[i]];
+            suit_multiplier[i] = state->suit_multiplier[pi[i]];
+        }
+
+        hand_index_t offset = record.offset;
+        switch (record.equal) {
+            case 0:  return offset + combine<0>(suit_index, suit_multiplier);
+            case 1:  return offset + combine<1>(suit_index, suit_multiplier);
+            case 2:  return offset + combine<2>(suit_index, suit_multiplier);
+            case 3:  return offset + combine<3>(suit_index, suit_multiplier);
+            case 4:  return offset + combine<4>(suit_index, suit_multiplier);
+            case 5:  return offset + combine<5>(suit_index, suit_multiplier);
+            case 6:  return offset + combine<6>(suit_index, suit_multiplier);
+            default: return offset + combine<7>(suit_index, suit_multiplier);
+        }
+    }
+
+    // Sort each group of equal suits and combine the groups, from suit I on.
+    template <uint32_t Mask, uint32_t I = 0>
+    HAND_ISO_ALWAYS_INLINE static hand_index_t combine(hand_index_t suit_index[HAND_INDEX_SUITS], const hand_index_t suit_multiplier[HAND_INDEX_SUITS]){
+        if constexpr (I == HAND_INDEX_SUITS) {
+            return 0;
+        } else {
+            constexpr uint32_t size = detail::group_size<Mask, I>();
+            if constexpr (size == 2) {
+                detail::compare_swap(suit_index, I, I + 1);
+            } else if constexpr (size == 3) {
+                detail::compare_swap(suit_index, I, I + 1);
+                detail::compare_swap(suit_index, I, I + 2);
+                detail::compare_swap(suit_index, I + 1, I + 2);
+            } else if constexpr (size == 4) {
+                detail::compare_swap(suit_index, I, I + 1);
+                detail::compare_swap(suit_index, I + 2, I + 3);
+                detail::compare_swap(suit_index, I, I + 2);
+                detail::compare_swap(suit_index, I + 1, I + 3);
+                detail::compare_swap(suit_index, I + 1, I + 2);
+            }
+            hand_index_t part = group_part<I>(suit_index, std::make_integer_sequence<uint32_t, size>{});
+            return part + detail::group_binomial<size>(suit_multiplier[I] + size - 1) * combine<Mask, I + size>(suit_index, suit_multiplier);
+        }
+    }
+
+    template <uint32_t I, uint32_t... K>
+    static hand_index_t group_part(const hand_index_t suit_index[HAND_INDEX_SUITS], std::integer_sequence<uint32_t, K...>){
+        return (0 + ... + detail::group_binomial<K + 1>(suit_index[I + K] + K));
+    }
+
+    const hand_indexer_t *indexer;
+    hand_index_tables_t tables;
+    const hand_index_permutation_t *permutation_to_record[rounds];
+};
+
+}  // namespace hand_iso
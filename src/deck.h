@@ -12,6 +12,10 @@
 
 #include <inttypes.h>
 
+#ifdef __BMI2__
+#include <immintrin.h>
+#endif
+
 #define SUITS     4
 #define RANKS    13
 #define CARDS    52
@@ -30,4 +34,56 @@ static inline card_t deck_make_card(card_t suit, card_t rank) {
   return rank<<2 | suit;
 }
 
+/* a card mask has bit card set for each card, so each suit's ranks are every fourth bit */
+#define DECK_SUIT_MASK 0x1111111111111ull
+
+static inline uint32_t deck_mask_get_ranks(uint64_t mask, card_t suit) {
+#ifdef __BMI2__
+  return (uint32_t)_pext_u64(mask, DECK_SUIT_MASK<<suit);
+#else
+  uint64_t x = mask>>suit&DECK_SUIT_MASK;
+  x = (x|x>>3)&0x0303030303030303ull;
+  x = (x|x>>6)&0x000f000f000f000full;
+  x = (x|x>>12)&0x000000ff000000ffull;
+  return (uint32_t)(x|x>>24)&0xffff;
+#endif
+}
+
+static inline uint64_t deck_ranks_make_mask(uint32_t ranks, card_t suit) {
+#ifdef __BMI2__
+  return _pdep_u64(ranks, DECK_SUIT_MASK<<suit);
+#else
+  uint64_t x = ranks;
+  x = (x|x<<24)&0x000000ff000000ffull;
+  x = (x|x<<12)&0x000f000f000f000full;
+  x = (x|x<<6)&0x0303030303030303ull;
+  x = (x|x<<3)&DECK_SUIT_MASK;
+  return x<<suit;
+#endif
+}
+
+static inline uint32_t deck_count_ranks(uint32_t ranks) {
+#if defined(__GNUC__) || defined(__clang__)
+  return __builtin_popcount(ranks);
+#else
+  ranks = ranks-(ranks>>1&0x55555555);
+  ranks = (ranks&0x33333333)+(ranks>>2&0x33333333);
+  return ((ranks+(ranks>>4))&0x0f0f0f0f)*0x01010101>>24;
+#endif
+}
+
+/* ranks renumbered among the ranks not in used, which ranks must not intersect */
+static inline uint32_t deck_shift_ranks(uint32_t ranks, uint32_t used) {
+#ifdef __BMI2__
+  return _pext_u32(ranks, ~used);
+#else
+  uint32_t shifted = 0;
+  for(uint32_t set=ranks; set; set&=set-1) {
+    uint32_t rank_bit = set&(0u-set);
+    shifted |= rank_bit>>deck_count_ranks((rank_bit-1)&used);
+  }
+  return shifted;
+#endif
+}
+
 #endif /* _DECK_H_ */
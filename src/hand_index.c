@@ -1,10 +1,20 @@
 #include <assert.h>
-#include <math.h>
 #include <stdbool.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include "deck.h"
 #include "hand_index.h"
 
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 #ifdef _MSC_VER
 #include <intrin.h>
 
@@ -19,6 +29,16 @@ static inline uint32_t __builtin_ctz(uint32_t x) {
     return (uint32_t)index;
 }
 
+static inline uint32_t __builtin_clzll(uint64_t x) {
+    unsigned long index;
+    // _BitScanReverse64 has undefined behavior when x == 0
+    if (x == 0) {
+        return 64;
+    }
+    _BitScanReverse64(&index, x);
+    return (uint32_t)(63 - index);
+}
+
 static inline uint32_t __builtin_popcount(uint32_t x) {
     // Software implementation for portability
     x = x - ((x >> 1) & 0x55555555);
@@ -30,16 +50,83 @@ static inline uint32_t __builtin_popcount(uint32_t x) {
 }
 #endif
 
-#define MAX_GROUP_INDEX        0x100000
+#define MAX_ROUNDS             HAND_INDEX_MAX_ROUNDS
 #define MAX_CARDS_PER_ROUND    15
 #define ROUND_SHIFT            4
 #define ROUND_MASK             0xf
 
-static uint8_t nth_unset[1<<RANKS][RANKS];
-static bool equal[1<<(SUITS-1)][SUITS];
-static uint32_t nCr_ranks[RANKS+1][RANKS+1], rank_set_to_index[1<<RANKS], index_to_rank_set[RANKS+1][1<<RANKS], (*suit_permutations)[SUITS];
-static hand_index_t nCr_groups[MAX_GROUP_INDEX][SUITS+1];
+#define SUIT_PERMUTATIONS      24  /* SUITS! */
+#define DIRECTORY_DENSITY      4   /* configuration directory entries per configuration */
+#define HUGE_PAGE_SIZE         (2u<<20)
+#define PERMUTATION_MAX_OFFSET (((hand_index_t)1<<56)-1)  /* largest offset a permutation record holds */
+
+/* the global tables are reached through pointers so that they can either be computed into
+ * the static storage by hand_index_ctor or be shared read only from a mapped file */
+static uint8_t nth_unset_table[1<<RANKS][RANKS], (*nth_unset)[RANKS];
+static bool equal_table[1<<(SUITS-1)][SUITS], (*equal)[SUITS];
+static uint32_t nCr_ranks_table[RANKS+1][RANKS+1], rank_set_to_index_table[1<<RANKS], index_to_rank_set_table[RANKS+1][1<<RANKS], suit_permutations_table[SUIT_PERMUTATIONS][SUITS];
+static uint32_t (*nCr_ranks)[RANKS+1], *rank_set_to_index, (*index_to_rank_set)[1<<RANKS], (*suit_permutations)[SUITS];
+
+/* nCr(n, k) for the k <= SUITS members of a group of equal suits.  each product is divided
+ * as soon as it is a binomial coefficient, so the division is exact and only overflows if
+ * the result is within a factor of k of overflowing. */
+static inline hand_index_t nCr_groups(hand_index_t n, uint32_t k) {
+  switch(k) {
+    case 0:  return 1;
+    case 1:  return n;
+    case 2:  return n*(n-1)/2;
+    case 3:  return n*(n-1)/2*(n-2)/3;
+    default: return n*(n-1)/2*(n-2)/3*(n-3)/4;
+  }
+}
+
+typedef void (*table_visitor_t)(void ** table, size_t size, void * data);
+
+static void visit_global_tables(table_visitor_t visit, void * data) {
+  visit((void**)&nth_unset,         sizeof(nth_unset_table),         data);
+  visit((void**)&equal,             sizeof(equal_table),             data);
+  visit((void**)&nCr_ranks,         sizeof(nCr_ranks_table),         data);
+  visit((void**)&rank_set_to_index, sizeof(rank_set_to_index_table), data);
+  visit((void**)&index_to_rank_set, sizeof(index_to_rank_set_table), data);
+  visit((void**)&suit_permutations, sizeof(suit_permutations_table), data);
+}
+
+/* the directory has at least DIRECTORY_DENSITY entries per configuration, so a few
+ * configurations at most start between two consecutive entries */
+static void set_directory_shift(hand_indexer_t * indexer) {
+  for(uint32_t i=0; i<indexer->rounds; ++i) {
+    uint32_t bits = 0; for(; (hand_index_t)1<<bits < (hand_index_t)indexer->configurations[i]*DIRECTORY_DENSITY; ++bits) {}
+    uint32_t size_bits = indexer->round_size[i] > 1 ? 64-__builtin_clzll(indexer->round_size[i]-1) : 0;
+    indexer->directory_shift[i] = size_bits > bits ? size_bits-bits : 0;
+  }
+}
+
+static size_t directory_entries(const hand_indexer_t * indexer, uint32_t round) {
+  return ((indexer->round_size[round]-1)>>indexer->directory_shift[round])+2;
+}
+
+static void visit_indexer_tables(hand_indexer_t * indexer, table_visitor_t visit, void * data) {
+  for(uint32_t i=0; i<indexer->rounds; ++i) {
+    visit((void**)&indexer->permutation_to_record[i],        indexer->permutations[i]*sizeof(hand_index_permutation_t), data);
+    visit((void**)&indexer->configuration_to_equal[i],       indexer->configurations[i]*sizeof(uint32_t),        data);
+    visit((void**)&indexer->configuration[i],                indexer->configurations[i]*SUITS*sizeof(uint32_t),  data);
+    visit((void**)&indexer->configuration_to_suit_size[i],   indexer->configurations[i]*SUITS*sizeof(uint32_t),  data);
+    visit((void**)&indexer->configuration_to_offset[i],      indexer->configurations[i]*sizeof(hand_index_t),    data);
+    visit((void**)&indexer->configuration_directory[i],      directory_entries(indexer, i)*sizeof(uint32_t),     data);
+  }
+}
+
 void hand_index_ctor() {
+  if (suit_permutations) {
+    return;
+  }
+
+  nth_unset         = nth_unset_table;
+  equal             = equal_table;
+  nCr_ranks         = nCr_ranks_table;
+  rank_set_to_index = rank_set_to_index_table;
+  index_to_rank_set = index_to_rank_set_table;
+
   for(uint32_t i=0; i<1<<(SUITS-1); ++i) {
     for(uint32_t j=1; j<SUITS; ++j) {
       equal[i][j] = i&1<<(j-1);
@@ -60,17 +147,6 @@ void hand_index_ctor() {
     }
   }
 
-  nCr_groups[0][0] = 1;
-  for(uint32_t i=1; i<MAX_GROUP_INDEX; ++i) {
-    nCr_groups[i][0] = 1;
-    if (i < SUITS+1) {
-      nCr_groups[i][i] = 1;
-    }
-    for(uint32_t j=1; j<(i<(SUITS+1)?i:(SUITS+1)); ++j) {
-      nCr_groups[i][j] = nCr_groups[i-1][j-1] + nCr_groups[i-1][j];
-    } 
-  }
-
   for(uint32_t i=0; i<1<<RANKS; ++i) {
     for(uint32_t set=i, j=1; set; ++j, set&=set-1) {
       rank_set_to_index[i]  += nCr_ranks[__builtin_ctz(set)][j];
@@ -78,21 +154,15 @@ void hand_index_ctor() {
     index_to_rank_set[__builtin_popcount(i)][rank_set_to_index[i]] = i;
   }
 
-  uint32_t num_permutations = 1;
-  for(uint32_t i=2; i<=SUITS; ++i) {
-    num_permutations *= i;
-  }
-
-  suit_permutations = calloc(num_permutations, SUITS*sizeof(uint32_t));
-  
-  for(uint32_t i=0; i<num_permutations; ++i) {
+  for(uint32_t i=0; i<SUIT_PERMUTATIONS; ++i) {
     for(uint32_t j=0, index=i, used=0; j<SUITS; ++j) {
       uint32_t suit = index%(SUITS-j); index /= SUITS-j;
       uint32_t shifted_suit = nth_unset[used][suit];
-      suit_permutations[i][j] = shifted_suit;
-      used                   |= 1<<shifted_suit;
+      suit_permutations_table[i][j] = shifted_suit;
+      used                         |= 1<<shifted_suit;
     }
   }
+  suit_permutations = suit_permutations_table;
 } 
 
 void enumerate_configurations_r(uint32_t rounds, const uint8_t cards_per_round[], 
@@ -183,14 +253,14 @@ out:;
       size *= nCr_ranks[remaining][ranks];
       remaining -= ranks;
     }
-    assert(size+SUITS-1 < MAX_GROUP_INDEX);
+    assert(size <= UINT32_MAX);
     
     uint32_t j=i+1; for(; j<SUITS && configuration[j] == configuration[i]; ++j) {} 
     for(uint32_t k=i; k<j; ++k) {
       indexer->configuration_to_suit_size[round][id][k] = size;
     }
 
-    indexer->configuration_to_offset[round][id] *= nCr_groups[size+j-i-1][j-i];
+    indexer->configuration_to_offset[round][id] *= nCr_groups(size+j-i-1, j-i);
     
     for(uint32_t k=i+1; k<j; ++k) {
       equal |= 1<<k;
@@ -297,8 +367,6 @@ void tabulate_permutations(uint32_t round, uint32_t count[], void * data) {
     pi_used |= this_bit;
   }
 
-  indexer->permutation_to_pi[round][idx] = pi_idx;
-
   uint32_t low = 0, high = indexer->configurations[round];
   while(low < high) {
     uint32_t mid = (low+high)/2;
@@ -323,7 +391,28 @@ void tabulate_permutations(uint32_t round, uint32_t count[], void * data) {
     }
   }
 
-  indexer->permutation_to_configuration[round][idx] = low;
+  hand_index_permutation_t * record = &indexer->permutation_to_record[round][idx];
+  record->offset = indexer->configuration_to_offset[round][low];
+  record->pi     = pi_idx;
+  record->equal  = indexer->configuration_to_equal[round][low];
+}
+
+/* zeroed storage for the tables read while indexing.  with HAND_INDEX_HUGE_PAGES, large
+ * tables are aligned to and padded out to whole huge pages that the kernel is asked to back
+ * them with, so one TLB entry covers up to 2 MB of records.  the result is freed with free. */
+static void * alloc_records(size_t count, size_t size) {
+#if defined(HAND_INDEX_HUGE_PAGES) && defined(__linux__)
+  size_t bytes = (count*size+HUGE_PAGE_SIZE-1)&~(size_t)(HUGE_PAGE_SIZE-1);
+  if (count*size >= HUGE_PAGE_SIZE/4) {
+    void * records = aligned_alloc(HUGE_PAGE_SIZE, bytes);
+    if (records) {
+      madvise(records, bytes, MADV_HUGEPAGE);
+      memset(records, 0, bytes);
+    }
+    return records;
+  }
+#endif
+  return calloc(count, size);
 }
 
 bool hand_indexer_init(uint32_t rounds, const uint8_t cards_per_round[], hand_indexer_t * indexer) {
@@ -375,16 +464,36 @@ bool hand_indexer_init(uint32_t rounds, const uint8_t cards_per_round[], hand_in
       accum = next;
     }
     indexer->round_size[i] = accum;
+    if (accum > PERMUTATION_MAX_OFFSET) {
+      hand_indexer_free(indexer);
+      return false;
+    }
+  }
+
+  set_directory_shift(indexer);
+  for(uint32_t i=0; i<rounds; ++i) {
+    size_t entries = directory_entries(indexer, i);
+    indexer->configuration_directory[i] = calloc(entries, sizeof(uint32_t));
+    if (!indexer->configuration_directory[i]) {
+      hand_indexer_free(indexer);
+      return false;
+    }
+
+    uint32_t configuration = 0;
+    for(size_t j=0; j<entries; ++j) {
+      hand_index_t first = (hand_index_t)j<<indexer->directory_shift[i];
+      for(; configuration+1 < indexer->configurations[i] &&
+          (first >= indexer->round_size[i] || indexer->configuration_to_offset[i][configuration+1] <= first); ++configuration) {}
+      indexer->configuration_directory[i][j] = configuration;
+    }
   }
 
   memset(indexer->permutations, 0, sizeof(indexer->permutations));
   enumerate_permutations(rounds, cards_per_round, count_permutations, indexer);
   
   for(uint32_t i=0; i<rounds; ++i) {
-    indexer->permutation_to_configuration[i] = calloc(indexer->permutations[i], sizeof(uint32_t));
-    indexer->permutation_to_pi[i] = calloc(indexer->permutations[i], sizeof(uint32_t));
-    if (!indexer->permutation_to_configuration[i] ||
-        !indexer->permutation_to_pi[i]) {
+    indexer->permutation_to_record[i] = alloc_records(indexer->permutations[i], sizeof(hand_index_permutation_t));
+    if (!indexer->permutation_to_record[i]) {
       hand_indexer_free(indexer);
       return false; 
     }
@@ -395,17 +504,40 @@ bool hand_indexer_init(uint32_t rounds, const uint8_t cards_per_round[], hand_in
   return true;
 }
 
+static void free_table(void ** table, size_t size, void * data) {
+  (void)size; (void)data;
+  free(*table);
+}
+
 void hand_indexer_free(hand_indexer_t * indexer) {
-  for(uint32_t i=0; i<indexer->rounds; ++i) {
-    free(indexer->permutation_to_configuration[i]);
-    free(indexer->permutation_to_pi[i]);
-    free(indexer->configuration_to_equal[i]);
-    free(indexer->configuration_to_offset[i]);
-    free(indexer->configuration[i]);
-    free(indexer->configuration_to_suit_size[i]);
+  if (!indexer->mapped) {
+    visit_indexer_tables(indexer, free_table, NULL);
   }
 }
 
+static void measure_table(void ** table, size_t size, void * data) {
+  (void)table;
+  *(size_t *)data += size;
+}
+
+void hand_index_tables(hand_index_tables_t * tables) {
+  tables->nCr_ranks         = (const uint32_t (*)[RANKS+1])nCr_ranks;
+  tables->rank_set_to_index = rank_set_to_index;
+  tables->suit_permutations = (const uint32_t (*)[SUITS])suit_permutations;
+}
+
+size_t hand_index_memory() {
+  size_t size = 0;
+  visit_global_tables(measure_table, &size);
+  return size;
+}
+
+size_t hand_indexer_memory(const hand_indexer_t * indexer) {
+  size_t size = 0;
+  visit_indexer_tables((hand_indexer_t *)indexer, measure_table, &size);
+  return size;
+}
+
 hand_index_t hand_indexer_size(const hand_indexer_t * indexer, uint32_t round) {
   assert(round < indexer->rounds);
   return indexer->round_size[round];
@@ -420,30 +552,65 @@ void hand_indexer_state_init(const hand_indexer_t * indexer, hand_indexer_state_
   }
 }
 
-hand_index_t hand_index_all(const hand_indexer_t * indexer, const uint8_t cards[], hand_index_t indices[]) {
-  if (indexer->rounds) {
-    hand_indexer_state_t state; hand_indexer_state_init(indexer, &state);
+/* the indexing and unindexing kernels are static inline and reached through the entry
+ * points of each instruction set flavour, see HAND_INDEX_FLAVOURS.  bmi2 is a constant
+ * of the flavour, selecting pext and pdep where the flavour's target has them. */
+#ifdef HAND_INDEX_DISPATCH
+#include <immintrin.h>
 
-    for(uint32_t i=0, j=0; i<indexer->rounds; j+=indexer->cards_per_round[i++]) {
-      indices[i] = hand_index_next_round(indexer, cards+j, &state);
-    }
+__attribute__((target("bmi2"))) static inline uint32_t pext_u32(uint32_t x, uint32_t mask) {
+  return _pext_u32(x, mask);
+}
 
-    return indices[indexer->rounds-1];
+__attribute__((target("bmi2"))) static inline uint64_t pext_u64(uint64_t x, uint64_t mask) {
+  return _pext_u64(x, mask);
+}
+
+__attribute__((target("bmi2"))) static inline uint64_t pdep_u64(uint64_t x, uint64_t mask) {
+  return _pdep_u64(x, mask);
+}
+#endif
+
+static inline uint32_t shift_ranks(uint32_t ranks, uint32_t used, bool bmi2) {
+#ifdef HAND_INDEX_DISPATCH
+  if (bmi2) {
+    return pext_u32(ranks, ~used);
   }
+#endif
+  return deck_shift_ranks(ranks, used);
+}
 
-  return 0;
+static inline uint32_t mask_get_ranks(uint64_t mask, card_t suit, bool bmi2) {
+#ifdef HAND_INDEX_DISPATCH
+  if (bmi2) {
+    return (uint32_t)pext_u64(mask, DECK_SUIT_MASK<<suit);
+  }
+#endif
+  return deck_mask_get_ranks(mask, suit);
 }
 
-hand_index_t hand_index_last(const hand_indexer_t * indexer, const uint8_t cards[]) {
-  hand_index_t indices[MAX_ROUNDS];
-  return hand_index_all(indexer, cards, indices);
+static inline uint64_t ranks_make_mask(uint32_t ranks, card_t suit, bool bmi2) {
+#ifdef HAND_INDEX_DISPATCH
+  if (bmi2) {
+    return pdep_u64(ranks, DECK_SUIT_MASK<<suit);
+  }
+#endif
+  return deck_ranks_make_mask(ranks, suit);
 }
 
-hand_index_t hand_index_next_round(const hand_indexer_t * indexer, const uint8_t cards[], hand_indexer_state_t * state) {
-  uint32_t round = state->round++;
+static inline uint32_t index_round_state(const hand_indexer_t * indexer, const uint32_t ranks[SUITS], const uint32_t shifted_ranks[SUITS], hand_indexer_state_t * state);
+static inline hand_index_t index_round_lookup(const hand_indexer_t * indexer, uint32_t round, const hand_indexer_state_t * state);
+static inline hand_index_t index_next_round(const hand_indexer_t * indexer, const uint32_t ranks[SUITS], const uint32_t shifted_ranks[SUITS], hand_indexer_state_t * state);
+
+/* the rank set dealt in each suit on the state's next round, and each renumbered among the
+ * ranks of the suit not used on earlier rounds */
+static inline void round_ranks(const hand_indexer_t * indexer, const uint8_t cards[], const hand_indexer_state_t * state, uint32_t ranks[SUITS], uint32_t shifted_ranks[SUITS]) {
+  uint32_t round = state->round;
   assert(round < indexer->rounds);
 
-  uint32_t ranks[SUITS] = {0}, shifted_ranks[SUITS] = {0};
+  for(uint32_t i=0; i<SUITS; ++i) {
+    ranks[i] = shifted_ranks[i] = 0;
+  }
   for(uint32_t i=0; i<indexer->cards_per_round[round]; ++i) {
     assert(cards[i] < CARDS);                 /* valid card */
 
@@ -452,6 +619,86 @@ hand_index_t hand_index_next_round(const hand_indexer_t * indexer, const uint8_t
     ranks[suit]               |= rank_bit;
     shifted_ranks[suit]       |= rank_bit>>__builtin_popcount((rank_bit-1)&state->used_ranks[suit]);
   }
+}
+
+static inline void round_mask_ranks(uint64_t cards, const hand_indexer_state_t * state, uint32_t ranks[SUITS], uint32_t shifted_ranks[SUITS], bool bmi2) {
+  for(uint32_t i=0; i<SUITS; ++i) {
+    ranks[i]         = mask_get_ranks(cards, i, bmi2);
+    shifted_ranks[i] = shift_ranks(ranks[i], state->used_ranks[i], bmi2);
+  }
+}
+
+static inline hand_index_t index_next_round_cards(const hand_indexer_t * indexer, const uint8_t cards[], hand_indexer_state_t * state) {
+  uint32_t ranks[SUITS], shifted_ranks[SUITS];
+  round_ranks(indexer, cards, state, ranks, shifted_ranks);
+  return index_next_round(indexer, ranks, shifted_ranks, state);
+}
+
+static inline hand_index_t index_next_round_ranks(const hand_indexer_t * indexer, const uint32_t ranks[SUITS], hand_indexer_state_t * state, bool bmi2) {
+  uint32_t shifted_ranks[SUITS];
+  for(uint32_t i=0; i<SUITS; ++i) {
+    shifted_ranks[i] = shift_ranks(ranks[i], state->used_ranks[i], bmi2);
+  }
+
+  return index_next_round(indexer, ranks, shifted_ranks, state);
+}
+
+static inline hand_index_t index_next_round_mask(const hand_indexer_t * indexer, uint64_t cards, hand_indexer_state_t * state, bool bmi2) {
+  uint32_t ranks[SUITS], shifted_ranks[SUITS];
+  round_mask_ranks(cards, state, ranks, shifted_ranks, bmi2);
+  return index_next_round(indexer, ranks, shifted_ranks, state);
+}
+
+static inline hand_index_t index_all(const hand_indexer_t * indexer, const uint8_t cards[], hand_index_t indices[]) {
+  if (indexer->rounds) {
+    hand_indexer_state_t state; hand_indexer_state_init(indexer, &state);
+
+    for(uint32_t i=0, j=0; i<indexer->rounds; j+=indexer->cards_per_round[i++]) {
+      indices[i] = index_next_round_cards(indexer, cards+j, &state);
+    }
+
+    return indices[indexer->rounds-1];
+  }
+
+  return 0;
+}
+
+/* the earlier rounds' indices are not needed, so those rounds only accumulate the per suit
+ * state, and the permutation lookup and sort run once, on the last round */
+static inline hand_index_t index_last(const hand_indexer_t * indexer, const uint8_t cards[]) {
+  if (!indexer->rounds) {
+    return 0;
+  }
+
+  hand_indexer_state_t state; hand_indexer_state_init(indexer, &state);
+  for(uint32_t i=0, j=0; i<indexer->rounds; j+=indexer->cards_per_round[i++]) {
+    uint32_t ranks[SUITS], shifted_ranks[SUITS];
+    round_ranks(indexer, cards+j, &state, ranks, shifted_ranks);
+    index_round_state(indexer, ranks, shifted_ranks, &state);
+  }
+
+  return index_round_lookup(indexer, indexer->rounds-1, &state);
+}
+
+static inline hand_index_t index_last_masks(const hand_indexer_t * indexer, const uint64_t cards[], bool bmi2) {
+  if (!indexer->rounds) {
+    return 0;
+  }
+
+  hand_indexer_state_t state; hand_indexer_state_init(indexer, &state);
+  for(uint32_t i=0; i<indexer->rounds; ++i) {
+    uint32_t ranks[SUITS], shifted_ranks[SUITS];
+    round_mask_ranks(cards[i], &state, ranks, shifted_ranks, bmi2);
+    index_round_state(indexer, ranks, shifted_ranks, &state);
+  }
+
+  return index_round_lookup(indexer, indexer->rounds-1, &state);
+}
+
+/* the per suit state of the next round, which only touches the small rank tables */
+static inline uint32_t index_round_state(const hand_indexer_t * indexer, const uint32_t ranks[SUITS], const uint32_t shifted_ranks[SUITS], hand_indexer_state_t * state) {
+  uint32_t round = state->round++;
+  assert(round < indexer->rounds);
 
   for(uint32_t i=0; i<SUITS; ++i) {
     assert(!(state->used_ranks[i]&ranks[i])); /* no duplicate cards */
@@ -462,6 +709,7 @@ hand_index_t hand_index_next_round(const hand_indexer_t * indexer, const uint8_t
     state->used_ranks[i]      |= ranks[i];
   }
 
+  assert(__builtin_popcount(ranks[0])+__builtin_popcount(ranks[1])+__builtin_popcount(ranks[2])+__builtin_popcount(ranks[3]) == indexer->cards_per_round[round]);
   for(uint32_t i=0, remaining=indexer->cards_per_round[round]; i<SUITS-1; ++i) {
     uint32_t this_size          = __builtin_popcount(ranks[i]);
     state->permutation_index        += state->permutation_multiplier*this_size;
@@ -469,11 +717,16 @@ hand_index_t hand_index_next_round(const hand_indexer_t * indexer, const uint8_t
     remaining                       -= this_size;
   }
 
-  uint32_t configuration = indexer->permutation_to_configuration[round][state->permutation_index];
-  uint32_t pi_index      = indexer->permutation_to_pi[round][state->permutation_index];
-  uint32_t equal_index   = indexer->configuration_to_equal[round][configuration];
-  hand_index_t offset         = indexer->configuration_to_offset[round][configuration];
-  const uint32_t * pi    = suit_permutations[pi_index];
+  return round;
+}
+
+/* the index of the hand on the state's last round, from the permutation record and the
+ * sorted groups of equal suits */
+static inline hand_index_t index_round_lookup(const hand_indexer_t * indexer, uint32_t round, const hand_indexer_state_t * state) {
+  const hand_index_permutation_t * record = &indexer->permutation_to_record[round][state->permutation_index];
+  uint32_t equal_index   = record->equal;
+  hand_index_t offset    = record->offset;
+  const uint32_t * pi    = suit_permutations[record->pi];
 
   hand_index_t suit_index[SUITS], suit_multiplier[SUITS];
   for(uint32_t i=0; i<SUITS; ++i) {
@@ -500,21 +753,21 @@ hand_index_t hand_index_next_round(const hand_indexer_t * indexer, const uint8_t
         if (i+3 < SUITS && equal[equal_index][i+3]) {
           /* four equal suits */
           swap(i, i+1); swap(i+2, i+3); swap(i, i+2); swap(i+1, i+3); swap(i+1, i+2);
-          part = suit_index[i] + nCr_groups[suit_index[i+1]+1][2] + nCr_groups[suit_index[i+2]+2][3] + nCr_groups[suit_index[i+3]+3][4];
-          size = nCr_groups[suit_multiplier[i]+3][4];
+          part = suit_index[i] + nCr_groups(suit_index[i+1]+1, 2) + nCr_groups(suit_index[i+2]+2, 3) + nCr_groups(suit_index[i+3]+3, 4);
+          size = nCr_groups(suit_multiplier[i]+3, 4);
           i += 4;
         } else {
           /* three equal suits */
           swap(i, i+1); swap(i, i+2); swap(i+1, i+2);
-          part = suit_index[i] + nCr_groups[suit_index[i+1]+1][2] + nCr_groups[suit_index[i+2]+2][3];
-          size = nCr_groups[suit_multiplier[i]+2][3];
+          part = suit_index[i] + nCr_groups(suit_index[i+1]+1, 2) + nCr_groups(suit_index[i+2]+2, 3);
+          size = nCr_groups(suit_multiplier[i]+2, 3);
           i += 3;
         }
       } else {
         /* two equal suits*/
         swap(i, i+1);
-        part = suit_index[i] + nCr_groups[suit_index[i+1]+1][2];
-        size = nCr_groups[suit_multiplier[i]+1][2];
+        part = suit_index[i] + nCr_groups(suit_index[i+1]+1, 2);
+        size = nCr_groups(suit_multiplier[i]+1, 2);
         i += 2;
       }
     } else {
@@ -533,69 +786,287 @@ hand_index_t hand_index_next_round(const hand_indexer_t * indexer, const uint8_t
   return index;
 }
 
-bool hand_unindex(const hand_indexer_t * indexer, uint32_t round, hand_index_t index, uint8_t cards[]) {
-  if (round >= indexer->rounds || index >= indexer->round_size[round]) {
-    return false;
+static inline hand_index_t index_next_round(const hand_indexer_t * indexer, const uint32_t ranks[SUITS], const uint32_t shifted_ranks[SUITS], hand_indexer_state_t * state) {
+  return index_round_lookup(indexer, index_round_state(indexer, ranks, shifted_ranks, state), state);
+}
+
+/* the suits of the hand in the state in canonical order: the permutation record's order of
+ * the configurations, with each group of equal suits sorted by suit index, largest first,
+ * as hand_unindex decodes a group */
+static inline void canonical_suits(const hand_indexer_t * indexer, uint32_t round, const hand_indexer_state_t * state, uint32_t suits[SUITS]) {
+  const hand_index_permutation_t * record = &indexer->permutation_to_record[round][state->permutation_index];
+  const uint32_t * pi    = suit_permutations[record->pi];
+  const bool * equal_suits = equal[record->equal];
+
+  for(uint32_t i=0; i<SUITS; ++i) {
+    suits[i] = pi[i];
+    for(uint32_t j=i; j>0 && equal_suits[j] && state->suit_index[suits[j-1]] < state->suit_index[suits[j]]; --j) {
+      uint32_t suit = suits[j]; suits[j] = suits[j-1]; suits[j-1] = suit;
+    }
   }
 
-  uint32_t low = 0, high = indexer->configurations[round], configuration_idx = 0;
-  while(low < high) {
-    uint32_t mid = (low+high)/2;
-    if (indexer->configuration_to_offset[round][mid] <= index) {
-      configuration_idx = mid;
-      low = mid+1;
-    } else {
-      high = mid;
+  for(uint32_t i=0; i<SUITS;) {
+    uint32_t j=i+1; for(; j<SUITS && equal_suits[j]; ++j) {}
+    uint32_t group[SUITS];
+    for(uint32_t k=i; k<j; ++k) {
+      group[k-i] = state->suit_index[suits[k]];
+    }
+    uint32_t tail = i+hand_index_group_tail(group, j-i);
+    if (tail < j) {
+      uint32_t suit = suits[tail]; suits[tail] = suits[tail+1]; suits[tail+1] = suit;
+    }
+    i = j;
+  }
+}
+
+static inline void canonicalize(const hand_indexer_t * indexer, const uint8_t cards[], uint8_t canonical_cards[], uint8_t suit_permutation[SUITS]) {
+  if (!indexer->rounds) {
+    return;
+  }
+
+  hand_indexer_state_t state; hand_indexer_state_init(indexer, &state);
+  uint32_t rank_sets[MAX_ROUNDS][SUITS];
+  for(uint32_t i=0, j=0; i<indexer->rounds; j+=indexer->cards_per_round[i++]) {
+    uint32_t shifted_ranks[SUITS];
+    round_ranks(indexer, cards+j, &state, rank_sets[i], shifted_ranks);
+    index_round_state(indexer, rank_sets[i], shifted_ranks, &state);
+  }
+
+  uint32_t suits[SUITS];
+  canonical_suits(indexer, indexer->rounds-1, &state, suits);
+
+  uint8_t location[MAX_ROUNDS]; memcpy(location, indexer->round_start, MAX_ROUNDS);
+  for(uint32_t i=0; i<SUITS; ++i) {
+    suit_permutation[suits[i]] = i;
+    for(uint32_t j=0; j<indexer->rounds; ++j) {
+      for(uint32_t set=rank_sets[j][suits[i]]; set; set&=set-1) {
+        canonical_cards[location[j]++] = deck_make_card(i, __builtin_ctz(set));
+      }
+    }
+  }
+}
+
+static inline void canonicalize_batch(const hand_indexer_t * indexer, const uint8_t cards[], size_t n, uint8_t canonical_cards[], uint8_t suit_permutations_out[]) {
+  if (!indexer->rounds) {
+    return;
+  }
+
+  uint32_t hand_size = indexer->round_start[indexer->rounds-1] + indexer->cards_per_round[indexer->rounds-1];
+  for(size_t i=0; i<n; ++i) {
+    canonicalize(indexer, cards+i*hand_size, canonical_cards+i*hand_size, suit_permutations_out+i*SUITS);
+  }
+}
+
+static inline void index_batch_block(const hand_indexer_t * indexer, const uint8_t cards[], uint32_t hand_size, hand_index_t indices[]) {
+  uint32_t suit_index[SUITS][HAND_INDEX_BATCH_LANES], suit_multiplier[SUITS][HAND_INDEX_BATCH_LANES], permutation_index[HAND_INDEX_BATCH_LANES];
+
+  /* first pass: the per suit state of every hand, which only touches the small rank tables */
+  for(uint32_t l=0; l<HAND_INDEX_BATCH_LANES; ++l) {
+    const uint8_t * hand = cards+l*hand_size;
+    uint32_t used[SUITS] = {0}, index[SUITS] = {0}, multiplier[SUITS] = {1, 1, 1, 1};
+    uint32_t permutation = 0, permutation_multiplier = 1;
+
+    for(uint32_t round=0; round<indexer->rounds; ++round) {
+      uint32_t ranks[SUITS] = {0}, shifted_ranks[SUITS] = {0};
+      for(uint32_t i=indexer->round_start[round]; i<indexer->round_start[round]+indexer->cards_per_round[round]; ++i) {
+        assert(hand[i] < CARDS);              /* valid card */
+
+        uint32_t suit = deck_get_suit(hand[i]), rank_bit = 1<<deck_get_rank(hand[i]);
+        assert(!(ranks[suit]&rank_bit));
+        ranks[suit]         |= rank_bit;
+        shifted_ranks[suit] |= rank_bit>>__builtin_popcount((rank_bit-1)&used[suit]);
+      }
+
+      for(uint32_t i=0, remaining=indexer->cards_per_round[round]; i<SUITS; ++i) {
+        assert(!(used[i]&ranks[i]));          /* no duplicate cards */
+
+        uint32_t used_size = __builtin_popcount(used[i]), this_size = __builtin_popcount(ranks[i]);
+        index[i]          += multiplier[i]*rank_set_to_index[shifted_ranks[i]];
+        multiplier[i]     *= nCr_ranks[RANKS-used_size][this_size];
+        used[i]           |= ranks[i];
+
+        if (i < SUITS-1) {
+          permutation            += permutation_multiplier*this_size;
+          permutation_multiplier *= remaining+1;
+          remaining              -= this_size;
+        }
+      }
+    }
+
+    for(uint32_t i=0; i<SUITS; ++i) {
+      suit_index[i][l]      = index[i];
+      suit_multiplier[i][l] = multiplier[i];
+    }
+    permutation_index[l] = permutation;
+  }
+
+  /* second pass: the permutation and configuration lookups of every lane are independent,
+   * so their cache misses overlap instead of serializing hand after hand */
+  uint32_t round = indexer->rounds-1, sorted[SUITS][HAND_INDEX_BATCH_LANES], multiplier[SUITS][HAND_INDEX_BATCH_LANES], equal_mask[HAND_INDEX_BATCH_LANES];
+  hand_index_t offset[HAND_INDEX_BATCH_LANES];
+  for(uint32_t l=0; l<HAND_INDEX_BATCH_LANES; ++l) {
+    const hand_index_permutation_t * record = &indexer->permutation_to_record[round][permutation_index[l]];
+    const uint32_t * pi    = suit_permutations[record->pi];
+    equal_mask[l]          = record->equal;
+    offset[l]              = record->offset;
+    for(uint32_t i=0; i<SUITS; ++i) {
+      sorted[i][l]     = suit_index[pi[i]][l];
+      multiplier[i][l] = suit_multiplier[pi[i]][l];
+    }
+  }
+
+  /* the optimal four suit sorting network, where a comparator only fires when both suits
+   * are in the same group of equal suits.  groups are contiguous, so this sorts each group
+   * exactly like the two, three and four suit networks of hand_index_next_round. */
+#define swap(u, v) \
+  do {\
+    for(uint32_t l=0; l<HAND_INDEX_BATCH_LANES; ++l) {\
+      uint32_t same = (equal_mask[l]>>(u) & ((1<<((v)-(u)))-1)) == ((1<<((v)-(u)))-1);\
+      uint32_t a = sorted[u][l], b = sorted[v][l];\
+      sorted[u][l] = same && b < a ? b : a;\
+      sorted[v][l] = same && b < a ? a : b;\
+    }\
+  } while(0)
+
+  swap(0, 1); swap(2, 3); swap(0, 2); swap(1, 3); swap(1, 2);
+
+#undef swap
+
+  for(uint32_t l=0; l<HAND_INDEX_BATCH_LANES; ++l) {
+    hand_index_t index = offset[l], group_multiplier = 1, part = 0;
+    for(uint32_t i=0, k=0; i<SUITS; ++i) {
+      part += nCr_groups(sorted[i][l]+k, k+1);
+      if (i+1 < SUITS && equal[equal_mask[l]][i+1]) {
+        ++k;
+      } else {
+        index            += group_multiplier*part;
+        group_multiplier *= nCr_groups(multiplier[i][l]+k, k+1);
+        part = k = 0;
+      }
+    }
+    indices[l] = index;
+  }
+}
+
+static inline void index_batch(const hand_indexer_t * indexer, const uint8_t cards[], size_t n, hand_index_t indices[]) {
+  if (!indexer->rounds) {
+    return;
+  }
+
+  uint32_t hand_size = indexer->round_start[indexer->rounds-1] + indexer->cards_per_round[indexer->rounds-1];
+
+  size_t i = 0;
+  for(; i+HAND_INDEX_BATCH_LANES<=n; i+=HAND_INDEX_BATCH_LANES) {
+    index_batch_block(indexer, cards+i*hand_size, hand_size, indices+i);
+  }
+  for(; i<n; ++i) {
+    indices[i] = index_last(indexer, cards+i*hand_size);
+  }
+}
+
+/* floor of the k-th root of x, by integer newton iteration from an overestimate */
+static inline hand_index_t integer_root(hand_index_t x, uint32_t k) {
+  if (!x) {
+    return 0;
+  }
+
+  hand_index_t root = (hand_index_t)1<<(64-__builtin_clzll(x)+k-1)/k;
+  for(;;) {
+    hand_index_t power = 1;
+    for(uint32_t i=1; i<k; ++i) {
+      power *= root;
     }
+    hand_index_t next = ((k-1)*root + x/power)/k;
+    if (next >= root) {
+      return root;
+    }
+    root = next;
+  }
+}
+
+/* largest m < limit with nCr(m+k-1, k) <= x.  k!nCr(m+k-1, k) = m(m+1)...(m+k-1) lies
+ * between m^k and (m+k-1)^k, so the k-th root of k!x is at most k-1 above m. */
+static inline uint32_t group_decode_colex(hand_index_t x, uint32_t k, uint32_t limit) {
+  static const hand_index_t factorial[SUITS+1] = {1, 1, 2, 6, 24};
+
+  assert(x <= UINT64_MAX/factorial[k]);
+  hand_index_t root = integer_root(x*factorial[k], k);
+
+  uint32_t m = root > k-1 ? root-(k-1) : 0;
+  if (m >= limit) {
+    m = limit-1;
+  }
+  for(; m+1 < limit && nCr_groups(m+k, k) <= x; ++m) {}
+
+  return m;
+}
+
+/* the configuration of round whose indices include index, which lies between the
+ * configurations of the directory entries around it */
+static inline uint32_t find_configuration(const hand_indexer_t * indexer, uint32_t round, hand_index_t index) {
+  const uint32_t * directory = indexer->configuration_directory[round]+(index>>indexer->directory_shift[round]);
+  uint32_t configuration_idx = directory[0];
+  for(; configuration_idx < directory[1] && indexer->configuration_to_offset[round][configuration_idx+1] <= index; ++configuration_idx) {}
+  return configuration_idx;
+}
+
+/* the configuration of the canonical hand of index and the suit index of each of its suits,
+ * whose digits are the suit's rank sets of each round, the first least significant */
+static inline bool unindex_suit_indices(const hand_indexer_t * indexer, uint32_t round, hand_index_t index, uint32_t * configuration, hand_index_t suit_index[SUITS]) {
+  if (round >= indexer->rounds || index >= indexer->round_size[round]) {
+    return false;
   }
+
+  uint32_t configuration_idx = *configuration = find_configuration(indexer, round, index);
   index -= indexer->configuration_to_offset[round][configuration_idx];
 
-  hand_index_t suit_index[SUITS];
   for(uint32_t i=0; i<SUITS;) {
     uint32_t j=i+1; for(; j<SUITS && indexer->configuration[round][configuration_idx][j] == indexer->configuration[round][configuration_idx][i]; ++j) {}
     
     uint32_t suit_size  = indexer->configuration_to_suit_size[round][configuration_idx][i];
-    hand_index_t group_size  = nCr_groups[suit_size+j-i-1][j-i];
+    hand_index_t group_size  = nCr_groups(suit_size+j-i-1, j-i);
     hand_index_t group_index = index%group_size; index /= group_size;
 
-    for(; i<j-1; ++i) {
-      suit_index[i] = low = floor(exp(log(group_index)/(j-i) - 1 + log(j-i))-j-i); high = ceil(exp(log(group_index)/(j-i) + log(j-i))-j+i+1);
-      if (high > suit_size) {
-        high = suit_size;
-      }
-      if (high <= low) {
-        low = 0;
-      }
-      while(low < high) {
-        uint32_t mid = (low+high)/2;
-        if (nCr_groups[mid+j-i-1][j-i] <= group_index) {
-          suit_index[i] = mid;
-          low = mid+1;
-        } else {
-          high = mid;
-        }
-      }
+    uint32_t k = j-i, group[SUITS];
+    for(uint32_t l=0; l+1<k; ++l) {
+      group[l]     = group_decode_colex(group_index, k-l, suit_size);
+      group_index -= nCr_groups(group[l]+k-l-1, k-l);
+    }
+    group[k-1] = (uint32_t)group_index;
 
-      //for(suit_index[i]=0; nCr_groups[suit_index[i]+1+j-i-1][j-i] <= group_index; ++suit_index[i]) {}
-      group_index -= nCr_groups[suit_index[i]+j-i-1][j-i]; 
+    uint32_t tail = hand_index_group_tail(group, k);
+    if (tail < k) {
+      group[tail] = 0; group[tail+1] = 1;
     }
+    for(uint32_t l=0; l<k; ++l) {
+      suit_index[i+l] = group[l];
+    }
+    i = j;
+  }
+
+  return true;
+}
 
-    suit_index[i] = group_index; ++i;
+/* the rank set of each suit dealt on each round up to round of the canonical hand of index */
+static inline bool unindex_rank_sets(const hand_indexer_t * indexer, uint32_t round, hand_index_t index, uint32_t rank_sets[MAX_ROUNDS][SUITS]) {
+  uint32_t configuration_idx;
+  hand_index_t suit_index[SUITS];
+  if (!unindex_suit_indices(indexer, round, index, &configuration_idx, suit_index)) {
+    return false;
   }
-  
-  uint8_t location[MAX_ROUNDS]; memcpy(location, indexer->round_start, MAX_ROUNDS);
+
   for(uint32_t i=0; i<SUITS; ++i) {
     uint32_t used = 0, m = 0;
-    for(uint32_t j=0; j<indexer->rounds; ++j) {
+    for(uint32_t j=0; j<=round; ++j) {
       uint32_t n              = indexer->configuration[round][configuration_idx][i]>>ROUND_SHIFT*(indexer->rounds-j-1)&ROUND_MASK;
       uint32_t round_size     = nCr_ranks[RANKS-m][n]; m += n;
       uint32_t round_idx      = suit_index[i]%round_size; suit_index[i] /= round_size;
       uint32_t shifted_cards  = index_to_rank_set[n][round_idx], rank_set = 0;
       for(uint32_t k=0; k<n; ++k) {
         uint32_t shifted_card = shifted_cards&-shifted_cards; shifted_cards ^= shifted_card;
-        uint32_t card         = nth_unset[used][__builtin_ctz(shifted_card)]; rank_set |= 1<<card;
-        cards[location[j]++]       = deck_make_card(i, card);
+        rank_set             |= 1<<nth_unset[used][__builtin_ctz(shifted_card)];
       }
+      rank_sets[j][i] = rank_set;
       used |= rank_set;
     }
   }
@@ -603,4 +1074,1032 @@ bool hand_unindex(const hand_indexer_t * indexer, uint32_t round, hand_index_t i
   return true;
 }
 
+static inline bool unindex_cards(const hand_indexer_t * indexer, uint32_t round, hand_index_t index, uint8_t cards[]) {
+  uint32_t rank_sets[MAX_ROUNDS][SUITS];
+  if (!unindex_rank_sets(indexer, round, index, rank_sets)) {
+    return false;
+  }
+
+  uint8_t location[MAX_ROUNDS]; memcpy(location, indexer->round_start, MAX_ROUNDS);
+  for(uint32_t i=0; i<SUITS; ++i) {
+    for(uint32_t j=0; j<=round; ++j) {
+      for(uint32_t set=rank_sets[j][i]; set; set&=set-1) {
+        cards[location[j]++] = deck_make_card(i, __builtin_ctz(set));
+      }
+    }
+  }
+
+  return true;
+}
 
+static inline bool unindex_masks(const hand_indexer_t * indexer, uint32_t round, hand_index_t index, uint64_t cards[], bool bmi2) {
+  uint32_t rank_sets[MAX_ROUNDS][SUITS];
+  if (!unindex_rank_sets(indexer, round, index, rank_sets)) {
+    return false;
+  }
+
+  for(uint32_t j=0; j<=round; ++j) {
+    cards[j] = 0;
+    for(uint32_t i=0; i<SUITS; ++i) {
+      cards[j] |= ranks_make_mask(rank_sets[j][i], i, bmi2);
+    }
+  }
+
+  return true;
+}
+
+static inline bool unindex_batch(const hand_indexer_t * indexer, uint32_t round, const hand_index_t indices[], size_t n, uint8_t cards[]) {
+  if (round >= indexer->rounds) {
+    return false;
+  }
+
+  uint32_t hand_size = indexer->round_start[round] + indexer->cards_per_round[round];
+
+  bool valid = true;
+  for(size_t i=0; i<n; ++i) {
+    valid &= unindex_cards(indexer, round, indices[i], cards+i*hand_size);
+  }
+
+  return valid;
+}
+
+typedef struct {
+  const char * name;
+  hand_index_t (*index_all)(const hand_indexer_t * indexer, const uint8_t cards[], hand_index_t indices[]);
+  hand_index_t (*index_last)(const hand_indexer_t * indexer, const uint8_t cards[]);
+  hand_index_t (*next_round)(const hand_indexer_t * indexer, const uint8_t cards[], hand_indexer_state_t * state);
+  hand_index_t (*next_round_ranks)(const hand_indexer_t * indexer, const uint32_t ranks[SUITS], hand_indexer_state_t * state);
+  hand_index_t (*next_round_mask)(const hand_indexer_t * indexer, uint64_t cards, hand_indexer_state_t * state);
+  hand_index_t (*last_masks)(const hand_indexer_t * indexer, const uint64_t cards[]);
+  void (*batch)(const hand_indexer_t * indexer, const uint8_t cards[], size_t n, hand_index_t indices[]);
+  void (*canonicalize)(const hand_indexer_t * indexer, const uint8_t cards[], uint8_t canonical_cards[], uint8_t suit_permutation[SUITS]);
+  void (*canonicalize_batch)(const hand_indexer_t * indexer, const uint8_t cards[], size_t n, uint8_t canonical_cards[], uint8_t suit_permutations_out[]);
+  bool (*unindex)(const hand_indexer_t * indexer, uint32_t round, hand_index_t index, uint8_t cards[]);
+  bool (*unindex_masks)(const hand_indexer_t * indexer, uint32_t round, hand_index_t index, uint64_t cards[]);
+  bool (*unindex_batch)(const hand_indexer_t * indexer, uint32_t round, const hand_index_t indices[], size_t n, uint8_t cards[]);
+} hand_index_kernels_t;
+
+#define DEFINE_KERNELS(flavour, attributes, bmi2) \
+  attributes static hand_index_t flavour##_index_all(const hand_indexer_t * indexer, const uint8_t cards[], hand_index_t indices[]) { \
+    return index_all(indexer, cards, indices); \
+  } \
+  attributes static hand_index_t flavour##_index_last(const hand_indexer_t * indexer, const uint8_t cards[]) { \
+    return index_last(indexer, cards); \
+  } \
+  attributes static hand_index_t flavour##_next_round(const hand_indexer_t * indexer, const uint8_t cards[], hand_indexer_state_t * state) { \
+    return index_next_round_cards(indexer, cards, state); \
+  } \
+  attributes static hand_index_t flavour##_next_round_ranks(const hand_indexer_t * indexer, const uint32_t ranks[SUITS], hand_indexer_state_t * state) { \
+    return index_next_round_ranks(indexer, ranks, state, bmi2); \
+  } \
+  attributes static hand_index_t flavour##_next_round_mask(const hand_indexer_t * indexer, uint64_t cards, hand_indexer_state_t * state) { \
+    return index_next_round_mask(indexer, cards, state, bmi2); \
+  } \
+  attributes static hand_index_t flavour##_last_masks(const hand_indexer_t * indexer, const uint64_t cards[]) { \
+    return index_last_masks(indexer, cards, bmi2); \
+  } \
+  attributes static void flavour##_batch(const hand_indexer_t * indexer, const uint8_t cards[], size_t n, hand_index_t indices[]) { \
+    index_batch(indexer, cards, n, indices); \
+  } \
+  attributes static void flavour##_canonicalize(const hand_indexer_t * indexer, const uint8_t cards[], uint8_t canonical_cards[], uint8_t suit_permutation[SUITS]) { \
+    canonicalize(indexer, cards, canonical_cards, suit_permutation); \
+  } \
+  attributes static void flavour##_canonicalize_batch(const hand_indexer_t * indexer, const uint8_t cards[], size_t n, uint8_t canonical_cards[], uint8_t suit_permutations_out[]) { \
+    canonicalize_batch(indexer, cards, n, canonical_cards, suit_permutations_out); \
+  } \
+  attributes static bool flavour##_unindex(const hand_indexer_t * indexer, uint32_t round, hand_index_t index, uint8_t cards[]) { \
+    return unindex_cards(indexer, round, index, cards); \
+  } \
+  attributes static bool flavour##_unindex_masks(const hand_indexer_t * indexer, uint32_t round, hand_index_t index, uint64_t cards[]) { \
+    return unindex_masks(indexer, round, index, cards, bmi2); \
+  } \
+  attributes static bool flavour##_unindex_batch(const hand_indexer_t * indexer, uint32_t round, const hand_index_t indices[], size_t n, uint8_t cards[]) { \
+    return unindex_batch(indexer, round, indices, n, cards); \
+  }
+
+HAND_INDEX_FLAVOURS(DEFINE_KERNELS)
+
+#undef DEFINE_KERNELS
+
+#define KERNELS_ENTRY(flavour, attributes, bmi2) \
+  {#flavour, flavour##_index_all, flavour##_index_last, flavour##_next_round, flavour##_next_round_ranks, flavour##_next_round_mask, flavour##_last_masks, \
+   flavour##_batch, flavour##_canonicalize, flavour##_canonicalize_batch, flavour##_unindex, flavour##_unindex_masks, flavour##_unindex_batch},
+
+static const hand_index_kernels_t kernels_table[] = {
+  HAND_INDEX_FLAVOURS(KERNELS_ENTRY)
+};
+
+#undef KERNELS_ENTRY
+
+#define KERNELS_COUNT (sizeof(kernels_table)/sizeof(kernels_table[0]))
+
+/* the generic kernels are last and run anywhere, so indexing before the selection is safe */
+static const hand_index_kernels_t * kernels = &kernels_table[KERNELS_COUNT-1];
+static bool kernels_selected = false;
+
+static bool kernels_supported(const hand_index_kernels_t * candidate) {
+#ifdef HAND_INDEX_DISPATCH
+  __builtin_cpu_init();
+  bool avx2 = __builtin_cpu_supports("popcnt") && __builtin_cpu_supports("sse4.2") && __builtin_cpu_supports("avx2") &&
+    __builtin_cpu_supports("bmi") && __builtin_cpu_supports("bmi2");
+  if (!strcmp(candidate->name, "avx512")) {
+    return avx2 && __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw") &&
+      __builtin_cpu_supports("avx512dq") && __builtin_cpu_supports("avx512vl");
+  } else if (!strcmp(candidate->name, "avx2")) {
+    return avx2;
+  } else if (!strcmp(candidate->name, "popcnt")) {
+    return __builtin_cpu_supports("popcnt") && __builtin_cpu_supports("sse4.2");
+  }
+#endif
+  return true;
+}
+
+/* pext and pdep are microcoded on zen and zen 2, where the popcount fallbacks are faster */
+static bool kernels_preferred(const hand_index_kernels_t * candidate) {
+#ifdef HAND_INDEX_DISPATCH
+  if (__builtin_cpu_is("znver1") || __builtin_cpu_is("znver2")) {
+    return !strcmp(candidate->name, "popcnt") || !strcmp(candidate->name, "generic");
+  }
+#endif
+  (void)candidate;
+  return true;
+}
+
+#ifdef HAND_INDEX_DISPATCH
+__attribute__((constructor))
+#endif
+static void select_kernels() {
+  if (kernels_selected) {
+    return;
+  }
+
+  for(uint32_t i=0; i<KERNELS_COUNT; ++i) {
+    if (kernels_supported(&kernels_table[i]) && kernels_preferred(&kernels_table[i])) {
+      kernels = &kernels_table[i];
+      break;
+    }
+  }
+  kernels_selected = true;
+}
+
+/* static initializers of other files may run before the constructor */
+const char * hand_index_kernels() {
+  select_kernels();
+  return kernels->name;
+}
+
+bool hand_index_use_kernels(const char * name) {
+  for(uint32_t i=0; i<KERNELS_COUNT; ++i) {
+    if (!strcmp(kernels_table[i].name, name)) {
+      if (!kernels_supported(&kernels_table[i])) {
+        return false;
+      }
+      kernels          = &kernels_table[i];
+      kernels_selected = true;
+      return true;
+    }
+  }
+  return false;
+}
+
+hand_index_t hand_index_all(const hand_indexer_t * indexer, const uint8_t cards[], hand_index_t indices[]) {
+  return kernels->index_all(indexer, cards, indices);
+}
+
+hand_index_t hand_index_last(const hand_indexer_t * indexer, const uint8_t cards[]) {
+  return kernels->index_last(indexer, cards);
+}
+
+hand_index_t hand_index_next_round(const hand_indexer_t * indexer, const uint8_t cards[], hand_indexer_state_t * state) {
+  return kernels->next_round(indexer, cards, state);
+}
+
+hand_index_t hand_index_next_round_ranks(const hand_indexer_t * indexer, const uint32_t ranks[SUITS], hand_indexer_state_t * state) {
+  return kernels->next_round_ranks(indexer, ranks, state);
+}
+
+hand_index_t hand_index_next_round_mask(const hand_indexer_t * indexer, uint64_t cards, hand_indexer_state_t * state) {
+  return kernels->next_round_mask(indexer, cards, state);
+}
+
+hand_index_t hand_index_last_masks(const hand_indexer_t * indexer, const uint64_t cards[]) {
+  return kernels->last_masks(indexer, cards);
+}
+
+void hand_index_batch(const hand_indexer_t * indexer, const uint8_t cards[], size_t n, hand_index_t indices[]) {
+  kernels->batch(indexer, cards, n, indices);
+}
+
+void hand_canonicalize(const hand_indexer_t * indexer, const uint8_t cards[], uint8_t canonical_cards[], uint8_t suit_permutation[SUITS]) {
+  kernels->canonicalize(indexer, cards, canonical_cards, suit_permutation);
+}
+
+void hand_canonicalize_batch(const hand_indexer_t * indexer, const uint8_t cards[], size_t n, uint8_t canonical_cards[], uint8_t suit_permutations_out[]) {
+  kernels->canonicalize_batch(indexer, cards, n, canonical_cards, suit_permutations_out);
+}
+
+bool hand_unindex(const hand_indexer_t * indexer, uint32_t round, hand_index_t index, uint8_t cards[]) {
+  return kernels->unindex(indexer, round, index, cards);
+}
+
+bool hand_unindex_masks(const hand_indexer_t * indexer, uint32_t round, hand_index_t index, uint64_t cards[]) {
+  return kernels->unindex_masks(indexer, round, index, cards);
+}
+
+bool hand_unindex_batch(const hand_indexer_t * indexer, uint32_t round, const hand_index_t indices[], size_t n, uint8_t cards[]) {
+  return kernels->unindex_batch(indexer, round, indices, n, cards);
+}
+
+/* the suit indices of a group of equal suits are kept as the multiset that the combinatorial
+ * number system assigns to the group's index, from which the successor of an index is the
+ * colex successor of its multiset.  hand_unindex's decoding differs when the tail of the
+ * multiset decodes the value 1 over two or four suits, which it assigns to the second suit
+ * of the tail rather than the first, so the suits are swapped back before use. */
+static void iterator_set_suit(hand_unindex_iterator_t * iterator, uint32_t suit, uint32_t suit_index) {
+  if (iterator->decoded && suit_index == iterator->suit_index[suit]+1) {
+    for(uint32_t j=0; j<=iterator->round && ++iterator->digits[suit][j] == iterator->radix[suit][j]; ++j) {
+      iterator->digits[suit][j] = 0;
+    }
+  } else {
+    for(uint32_t j=0, rest=suit_index; j<=iterator->round; ++j) {
+      iterator->digits[suit][j] = rest%iterator->radix[suit][j]; rest /= iterator->radix[suit][j];
+    }
+  }
+  iterator->suit_index[suit] = suit_index;
+
+  /* no ranks are used before the first round, so its shifted ranks are its ranks */
+  uint32_t used = index_to_rank_set[iterator->suit_cards[suit][0]][iterator->digits[suit][0]];
+  uint8_t * first = iterator->cards+iterator->location[suit][0];
+  for(uint32_t set=used; set; set &= set-1) {
+    *first++ = deck_make_card(suit, __builtin_ctz(set));
+  }
+  for(uint32_t j=1; j<=iterator->round; ++j) {
+    uint32_t shifted_cards = index_to_rank_set[iterator->suit_cards[suit][j]][iterator->digits[suit][j]], rank_set = 0;
+    uint8_t * cards = iterator->cards+iterator->location[suit][j];
+    for(; shifted_cards; shifted_cards &= shifted_cards-1) {
+      uint32_t card = nth_unset[used][__builtin_ctz(shifted_cards)]; rank_set |= 1<<card;
+      *cards++      = deck_make_card(suit, card);
+    }
+    used |= rank_set;
+  }
+}
+
+static void iterator_set_group(hand_unindex_iterator_t * iterator, uint32_t group) {
+  uint32_t i = iterator->group_start[group], j = iterator->group_start[group+1], suit_index[SUITS];
+  memcpy(suit_index+i, iterator->multiset+i, (j-i)*sizeof(uint32_t));
+
+  uint32_t tail = i+hand_index_group_tail(suit_index+i, j-i);
+  if (tail < j) {
+    suit_index[tail] = 0; suit_index[tail+1] = 1;
+  }
+
+  for(uint32_t k=i; k<j; ++k) {
+    if (suit_index[k] != iterator->suit_index[k] || !iterator->decoded) {
+      iterator_set_suit(iterator, k, suit_index[k]);
+    }
+  }
+}
+
+static void iterator_decode_group(hand_unindex_iterator_t * iterator, uint32_t group, hand_index_t group_index) {
+  uint32_t i = iterator->group_start[group], j = iterator->group_start[group+1];
+  iterator->group_index[group] = group_index;
+  for(; i<j-1; ++i) {
+    iterator->multiset[i] = group_decode_colex(group_index, j-i, iterator->group_limit[group]);
+    group_index          -= nCr_groups(iterator->multiset[i]+j-i-1, j-i);
+  }
+  iterator->multiset[i] = group_index;
+  iterator_set_group(iterator, group);
+}
+
+bool hand_unindex_iterator_init(const hand_indexer_t * indexer, uint32_t round, hand_index_t index, hand_unindex_iterator_t * iterator) {
+  if (round >= indexer->rounds || index >= indexer->round_size[round]) {
+    return false;
+  }
+
+  uint32_t configuration = find_configuration(indexer, round, index);
+  iterator->indexer           = indexer;
+  iterator->round             = round;
+  iterator->index             = index;
+  iterator->configuration_end = configuration+1 < indexer->configurations[round]?
+    indexer->configuration_to_offset[round][configuration+1]:indexer->round_size[round];
+  iterator->decoded           = false;
+
+  uint8_t location[MAX_ROUNDS]; memcpy(location, indexer->round_start, MAX_ROUNDS);
+  for(uint32_t i=0; i<SUITS; ++i) {
+    for(uint32_t j=0, m=0; j<=round; ++j) {
+      uint32_t n                  = indexer->configuration[round][configuration][i]>>ROUND_SHIFT*(indexer->rounds-j-1)&ROUND_MASK;
+      iterator->suit_cards[i][j]  = n;
+      iterator->radix[i][j]       = nCr_ranks[RANKS-m][n]; m += n;
+      iterator->location[i][j]    = location[j]; location[j] += n;
+    }
+  }
+
+  index -= indexer->configuration_to_offset[round][configuration];
+  iterator->groups = 0;
+  for(uint32_t i=0; i<SUITS; ++iterator->groups) {
+    uint32_t j=i+1; for(; j<SUITS && indexer->configuration[round][configuration][j] == indexer->configuration[round][configuration][i]; ++j) {}
+
+    uint32_t group = iterator->groups;
+    iterator->group_start[group] = i;
+    iterator->group_limit[group] = indexer->configuration_to_suit_size[round][configuration][i];
+    iterator->group_size[group]  = nCr_groups(iterator->group_limit[group]+j-i-1, j-i);
+    i = j;
+  }
+  iterator->group_start[iterator->groups] = SUITS;
+
+  for(uint32_t group=0; group<iterator->groups; ++group) {
+    hand_index_t group_index = index%iterator->group_size[group]; index /= iterator->group_size[group];
+    iterator_decode_group(iterator, group, group_index);
+  }
+  iterator->decoded = true;
+
+  return true;
+}
+
+bool hand_unindex_iterator_next(hand_unindex_iterator_t * iterator) {
+  if (++iterator->index == iterator->configuration_end) {
+    return hand_unindex_iterator_init(iterator->indexer, iterator->round, iterator->index, iterator);
+  }
+
+  for(uint32_t group=0;; ++group) {
+    uint32_t i = iterator->group_start[group], j = iterator->group_start[group+1], k = j-1;
+    for(; k > i && iterator->multiset[k] == iterator->multiset[k-1]; --k) {}
+
+    if (j-i == 1 && iterator->multiset[i]+1 < iterator->group_limit[group]) {
+      ++iterator->group_index[group];
+      iterator_set_suit(iterator, i, ++iterator->multiset[i]);
+      return true;
+    }
+    if (k > i || iterator->multiset[i]+1 < iterator->group_limit[group]) {
+      ++iterator->group_index[group];
+      ++iterator->multiset[k]; memset(iterator->multiset+k+1, 0, (j-k-1)*sizeof(uint32_t));
+      iterator_set_group(iterator, group);
+      return true;
+    }
+
+    iterator->group_index[group] = 0;
+    memset(iterator->multiset+i, 0, (j-i)*sizeof(uint32_t));
+    iterator_set_group(iterator, group);
+  }
+}
+
+bool hand_unindex_iterator_advance(hand_unindex_iterator_t * iterator, hand_index_t stride) {
+  if (stride == 1) {
+    return hand_unindex_iterator_next(iterator);
+  }
+  if (stride >= iterator->configuration_end-iterator->index) {
+    return hand_unindex_iterator_init(iterator->indexer, iterator->round, iterator->index+stride, iterator);
+  }
+
+  iterator->index += stride;
+  for(uint32_t group=0; stride; ++group) {
+    hand_index_t group_index = iterator->group_index[group]+stride;
+    stride       = group_index/iterator->group_size[group];
+    group_index %= iterator->group_size[group];
+    if (group_index != iterator->group_index[group]) {
+      iterator_decode_group(iterator, group, group_index);
+    }
+  }
+
+  return true;
+}
+
+/* for each suit of the canonical hand of index, the nearest earlier suit holding the same
+ * cards on every round through round, or SUITS.  only suits in one group of equal
+ * configuration can hold the same cards, so no others are compared. */
+static bool orbit_rank_sets(const hand_indexer_t * indexer, uint32_t round, hand_index_t index, uint32_t rank_sets[MAX_ROUNDS][SUITS], uint32_t same[SUITS]) {
+  if (!unindex_rank_sets(indexer, round, index, rank_sets)) {
+    return false;
+  }
+
+  const bool * equal_suits = equal[indexer->configuration_to_equal[round][find_configuration(indexer, round, index)]];
+  for(uint32_t i=0, group=0; i<SUITS; ++i) {
+    if (!equal_suits[i]) {
+      group = i;
+    }
+    same[i] = SUITS;
+    for(uint32_t k=i; k-->group && same[i] == SUITS;) {
+      uint32_t j=0; for(; j<=round && rank_sets[j][k] == rank_sets[j][i]; ++j) {}
+      if (j > round) {
+        same[i] = k;
+      }
+    }
+  }
+
+  return true;
+}
+
+/* assign suit a real suit above that of the earlier suit with the same cards, so each
+ * distinct relabelling is visited once */
+static void expand_suits(const hand_indexer_t * indexer, uint32_t round, const uint32_t rank_sets[MAX_ROUNDS][SUITS], const uint32_t same[SUITS],
+                         uint32_t suit, uint32_t used, uint32_t pi[SUITS], hand_index_t * count, hand_expand_callback_t callback, void * data) {
+  if (suit == SUITS) {
+    uint8_t cards[CARDS], location[MAX_ROUNDS]; memcpy(location, indexer->round_start, MAX_ROUNDS);
+    for(uint32_t i=0; i<SUITS; ++i) {
+      for(uint32_t j=0; j<=round; ++j) {
+        for(uint32_t set=rank_sets[j][i]; set; set&=set-1) {
+          cards[location[j]++] = deck_make_card(pi[i], __builtin_ctz(set));
+        }
+      }
+    }
+    callback(cards, data); ++*count;
+    return;
+  }
+
+  for(uint32_t s=same[suit] < SUITS ? pi[same[suit]]+1 : 0; s<SUITS; ++s) {
+    if (!(used&1<<s)) {
+      pi[suit] = s;
+      expand_suits(indexer, round, rank_sets, same, suit+1, used|1<<s, pi, count, callback, data);
+    }
+  }
+}
+
+/* the relabellings of a group of equal suits with suit indices m, in descending order, that
+ * give the same hand: the product of the factorials of its repeated suit indices */
+static inline uint32_t group_stabilizer(const uint32_t m[], uint32_t k) {
+  uint32_t stabilizer = 1;
+  for(uint32_t i=1, repeats=1; i<k; ++i) {
+    repeats     = m[i] == m[i-1] ? repeats+1 : 1;
+    stabilizer *= repeats;
+  }
+  return stabilizer;
+}
+
+/* the next suit indices of a group after m in the colex order group_decode_colex decodes, or false
+ * after the last */
+static inline bool group_next(uint32_t m[], uint32_t k, uint32_t limit) {
+  for(uint32_t j=k; j-->0;) {
+    if (j ? m[j] < m[j-1] : m[0]+1 < limit) {
+      ++m[j];
+      for(uint32_t i=j+1; i<k; ++i) {
+        m[i] = 0;
+      }
+      return true;
+    }
+  }
+  return false;
+}
+
+bool hand_multiplicities(const hand_indexer_t * indexer, uint32_t round, hand_index_t first, size_t n, uint8_t multiplicities[]) {
+  if (round >= indexer->rounds || first > indexer->round_size[round] || n > indexer->round_size[round]-first) {
+    return false;
+  }
+
+  for(hand_index_t index=first, last=first+n; index<last;) {
+    uint32_t configuration_idx = find_configuration(indexer, round, index);
+    const uint32_t * configuration = indexer->configuration[round][configuration_idx];
+    hand_index_t end = configuration_idx+1 < indexer->configurations[round] ?
+      indexer->configuration_to_offset[round][configuration_idx+1] : indexer->round_size[round];
+    if (end > last) {
+      end = last;
+    }
+
+    /* the leading groups of a single suit never repeat a suit index, so indices that differ
+     * only in them make runs with one multiplicity.  the other groups are stepped through
+     * their suit indices one run at a time. */
+    hand_index_t offset = index-indexer->configuration_to_offset[round][configuration_idx], run = 1, run_offset = 0;
+    uint32_t groups = 0, k[SUITS], limit[SUITS], m[SUITS][SUITS];
+    for(uint32_t i=0; i<SUITS;) {
+      uint32_t j=i+1; for(; j<SUITS && configuration[j] == configuration[i]; ++j) {}
+
+      uint32_t suit_size       = indexer->configuration_to_suit_size[round][configuration_idx][i];
+      hand_index_t group_size  = nCr_groups(suit_size+j-i-1, j-i);
+      hand_index_t group_index = offset%group_size; offset /= group_size;
+
+      if (j-i == 1 && !groups) {
+        run_offset += run*group_index;
+        run        *= group_size;
+      } else {
+        k[groups] = j-i; limit[groups] = suit_size;
+        for(uint32_t l=0; l+1<j-i; ++l) {
+          m[groups][l] = group_decode_colex(group_index, j-i-l, suit_size);
+          group_index -= nCr_groups(m[groups][l]+j-i-l-1, j-i-l);
+        }
+        m[groups][j-i-1] = group_index; ++groups;
+      }
+      i = j;
+    }
+
+    for(;;) {
+      uint32_t stabilizer = 1;
+      for(uint32_t g=0; g<groups; ++g) {
+        stabilizer *= group_stabilizer(m[g], k[g]);
+      }
+
+      hand_index_t count = run-run_offset < end-index ? run-run_offset : end-index;
+      memset(multiplicities+(index-first), SUIT_PERMUTATIONS/stabilizer, count);
+      index += count; run_offset = 0;
+      if (index == end) {
+        break;
+      }
+
+      for(uint32_t g=0; g<groups && !group_next(m[g], k[g], limit[g]); ++g) {
+        memset(m[g], 0, sizeof(m[g]));
+      }
+    }
+  }
+
+  return true;
+}
+
+hand_index_t hand_expand_count(const hand_indexer_t * indexer, uint32_t round, hand_index_t index) {
+  uint8_t multiplicity;
+  if (!hand_multiplicities(indexer, round, index, 1, &multiplicity)) {
+    return 0;
+  }
+  return multiplicity;
+}
+
+hand_index_t hand_expand(const hand_indexer_t * indexer, uint32_t round, hand_index_t index, hand_expand_callback_t callback, void * data) {
+  uint32_t rank_sets[MAX_ROUNDS][SUITS], same[SUITS], pi[SUITS] = {0};
+  if (!orbit_rank_sets(indexer, round, index, rank_sets, same)) {
+    return 0;
+  }
+
+  hand_index_t count = 0;
+  expand_suits(indexer, round, (const uint32_t (*)[SUITS])rank_sets, same, 0, 0, pi, &count, callback, data);
+  return count;
+}
+
+/* the state of the canonical hand of index after to_round, from the digits of its suit
+ * indices through to_round */
+static inline bool project_state(const hand_indexer_t * indexer, uint32_t round, hand_index_t index, uint32_t to_round, hand_indexer_state_t * state) {
+  uint32_t configuration_idx;
+  hand_index_t suit_index[SUITS];
+  if (to_round > round || !unindex_suit_indices(indexer, round, index, &configuration_idx, suit_index)) {
+    return false;
+  }
+
+  const uint32_t * configuration = indexer->configuration[round][configuration_idx];
+  hand_indexer_state_init(indexer, state);
+  state->round = to_round+1;
+  for(uint32_t i=0; i<SUITS; ++i) {
+    for(uint32_t j=0, m=0; j<=to_round; ++j) {
+      uint32_t n             = configuration[i]>>ROUND_SHIFT*(indexer->rounds-j-1)&ROUND_MASK;
+      state->suit_multiplier[i] *= nCr_ranks[RANKS-m][n]; m += n;
+    }
+    state->suit_index[i] = suit_index[i]%state->suit_multiplier[i];
+  }
+  for(uint32_t j=0; j<=to_round; ++j) {
+    for(uint32_t i=0, remaining=indexer->cards_per_round[j]; i<SUITS-1; ++i) {
+      uint32_t n                      = configuration[i]>>ROUND_SHIFT*(indexer->rounds-j-1)&ROUND_MASK;
+      state->permutation_index       += state->permutation_multiplier*n;
+      state->permutation_multiplier  *= remaining+1;
+      remaining                      -= n;
+    }
+  }
+
+  return true;
+}
+
+bool hand_index_project(const hand_indexer_t * indexer, uint32_t round, hand_index_t index, uint32_t to_round, hand_index_t * projected) {
+  hand_indexer_state_t state;
+  if (!project_state(indexer, round, index, to_round, &state)) {
+    return false;
+  }
+  *projected = index_round_lookup(indexer, to_round, &state);
+  return true;
+}
+
+bool hand_index_project_batch(const hand_indexer_t * indexer, uint32_t round, const hand_index_t indices[], size_t n, uint32_t to_round, hand_index_t projected[]) {
+  bool valid = true;
+  for(size_t i=0; i<n; ++i) {
+    if (!hand_index_project(indexer, round, indices[i], to_round, &projected[i])) {
+      projected[i] = UINT64_MAX;
+      valid        = false;
+    }
+  }
+  return valid;
+}
+
+/* next deals one card more than indexer, on a round of its own or on one of indexer's rounds */
+static bool successors_compatible(const hand_indexer_t * indexer, const hand_indexer_t * next) {
+  if ((next->rounds != indexer->rounds && next->rounds != indexer->rounds+1) || next->round_size[next->rounds-1] > HAND_INDEX_NO_SUCCESSOR) {
+    return false;
+  }
+  uint32_t extended = 0;
+  for(uint32_t i=0; i<indexer->rounds; ++i) {
+    if (next->cards_per_round[i] == indexer->cards_per_round[i]+1) {
+      ++extended;
+    } else if (next->cards_per_round[i] != indexer->cards_per_round[i]) {
+      return false;
+    }
+  }
+  if (next->rounds == indexer->rounds) {
+    return extended == 1;
+  }
+  return !extended && next->cards_per_round[indexer->rounds] == 1;
+}
+
+bool hand_successors(const hand_indexer_t * indexer, const hand_indexer_t * next, const uint8_t cards[], size_t n, uint32_t successors[]) {
+  if (!successors_compatible(indexer, next)) {
+    return false;
+  }
+
+  uint32_t rounds = indexer->rounds, hand_size = indexer->round_start[rounds-1]+indexer->cards_per_round[rounds-1];
+
+  /* with as many rounds, the card joins the round that deals one more, after its cards */
+  uint32_t extended = 0;
+  for(; extended<rounds-1 && next->cards_per_round[extended] == indexer->cards_per_round[extended]; ++extended) {}
+  uint32_t at = indexer->round_start[extended]+indexer->cards_per_round[extended];
+
+  for(size_t i=0; i<n; ++i, cards+=hand_size, successors+=CARDS) {
+    uint64_t used = 0;
+    for(uint32_t j=0; j<hand_size; ++j) {
+      used |= 1ull<<cards[j];
+    }
+
+    if (next->rounds > rounds) {
+      /* the hand's rounds are indexed once and each card only extends the state */
+      hand_indexer_state_t state; hand_indexer_state_init(next, &state);
+      for(uint32_t j=0; j<rounds; ++j) {
+        kernels->next_round(next, cards+indexer->round_start[j], &state);
+      }
+      for(uint8_t card=0; card<CARDS; ++card) {
+        hand_indexer_state_t with_card = state;
+        successors[card] = used>>card&1 ? HAND_INDEX_NO_SUCCESSOR : (uint32_t)kernels->next_round(next, &card, &with_card);
+      }
+    } else {
+      uint8_t hand[CARDS]; memcpy(hand, cards, at); memcpy(hand+at+1, cards+at, hand_size-at);
+      for(uint8_t card=0; card<CARDS; ++card) {
+        hand[at]         = card;
+        successors[card] = used>>card&1 ? HAND_INDEX_NO_SUCCESSOR : (uint32_t)kernels->index_last(next, hand);
+      }
+    }
+  }
+
+  return true;
+}
+
+#define FILE_MAGIC             "HANDINDX"
+#define FILE_VERSION           5
+#define FILE_ENDIAN            0x01020304
+#define FILE_ALIGNMENT         64
+#define SUCCESSOR_MAGIC        "HANDSUCC"
+#define PROJECTION_MAGIC       "HANDPROJ"
+#define TABLE_VERSION          1
+
+struct file_header_s {
+  char magic[8];
+  uint32_t version, endian, indexers, reserved;
+  uint64_t size, checksum;
+};
+
+/* everything but the table pointers of a hand_indexer_t */
+struct file_indexer_s {
+  uint8_t cards_per_round[MAX_ROUNDS], round_start[MAX_ROUNDS];
+  uint32_t rounds, configurations[MAX_ROUNDS], permutations[MAX_ROUNDS], reserved;
+  hand_index_t round_size[MAX_ROUNDS];
+};
+
+/* a table of entries of bits each for every index of the last round of one indexer, such as
+ * a successor or projection table, which follows the header.  the shapes of the indexer and of
+ * the indexer its entries index identify the table. */
+struct table_header_s {
+  char magic[8];
+  uint32_t version, endian;
+  uint8_t cards_per_round[MAX_ROUNDS], next_cards_per_round[MAX_ROUNDS];
+  uint32_t rounds, next_rounds, bits, reserved;
+  uint64_t hands, size, checksum;
+};
+
+struct file_cursor_s {
+  uint8_t * base;
+  size_t offset, size;
+  bool assign, valid;
+  FILE * file;
+  uint64_t checksum;
+};
+
+static size_t file_align(size_t offset) {
+  return (offset+FILE_ALIGNMENT-1)&~(size_t)(FILE_ALIGNMENT-1);
+}
+
+static uint64_t file_checksum(uint64_t hash, const uint8_t * data, size_t size) {
+  /* 64 bit FNV-1a over words, every section is padded to a multiple of the word size */
+  for(size_t i=0; i+8<=size; i+=8) {
+    uint64_t word; memcpy(&word, data+i, 8);
+    hash = (hash^word)*0x100000001b3ull;
+  }
+  return hash;
+}
+
+static void file_write(struct file_cursor_s * cursor, const void * data, size_t size) {
+  static const uint8_t padding[FILE_ALIGNMENT] = {0};
+
+  size_t pad = file_align(size)-size;
+  cursor->valid    &= fwrite(data, 1, size, cursor->file) == size && fwrite(padding, 1, pad, cursor->file) == pad;
+  cursor->checksum  = file_checksum(cursor->checksum, data, size-size%8);
+  if (size%8) {
+    uint8_t tail[8] = {0}; memcpy(tail, (const uint8_t *)data+size-size%8, size%8);
+    cursor->checksum = file_checksum(cursor->checksum, tail, 8);
+  }
+  cursor->checksum  = file_checksum(cursor->checksum, padding, pad-pad%8);
+}
+
+static void save_table(void ** table, size_t size, void * data) {
+  file_write(data, *table, size);
+}
+
+static void map_table(void ** table, size_t size, void * data) {
+  struct file_cursor_s * cursor = data;
+
+  if (!cursor->valid || size > cursor->size-cursor->offset) {
+    cursor->valid = false;
+    return;
+  }
+  if (cursor->assign) {
+    *table = cursor->base+cursor->offset;
+  }
+  cursor->offset = file_align(cursor->offset+size);
+}
+
+bool hand_index_save(const char * path, uint32_t count, const hand_indexer_t * const indexers[]) {
+  if (!suit_permutations) {
+    return false;
+  }
+
+  struct file_cursor_s cursor = {0};
+  cursor.file  = fopen(path, "wb");
+  cursor.valid = cursor.file != NULL;
+  if (!cursor.valid) {
+    return false;
+  }
+
+  struct file_header_s header = {.magic = FILE_MAGIC, .version = FILE_VERSION, .endian = FILE_ENDIAN, .indexers = count};
+  size_t size = file_align(sizeof(header))+file_align(count*sizeof(struct file_indexer_s));
+  for(uint32_t i=0; i<count; ++i) {
+    struct file_cursor_s measure = {.size = SIZE_MAX, .valid = true};
+    visit_indexer_tables((hand_indexer_t *)indexers[i], map_table, &measure);
+    size += measure.offset;
+  }
+  struct file_cursor_s measure = {.size = SIZE_MAX, .valid = true};
+  visit_global_tables(map_table, &measure);
+  header.size = size+measure.offset;
+
+  /* the header is rewritten with the checksum once the rest of the file is known */
+  file_write(&cursor, &header, sizeof(header));
+  cursor.checksum = 0xcbf29ce484222325ull;
+
+  struct file_indexer_s * records = calloc(count ? count : 1, sizeof(struct file_indexer_s));
+  cursor.valid &= records != NULL;
+  for(uint32_t i=0; cursor.valid && i<count; ++i) {
+    memcpy(records[i].cards_per_round, indexers[i]->cards_per_round, MAX_ROUNDS);
+    memcpy(records[i].round_start,     indexers[i]->round_start,     MAX_ROUNDS);
+    memcpy(records[i].configurations,  indexers[i]->configurations,  sizeof(records[i].configurations));
+    memcpy(records[i].permutations,    indexers[i]->permutations,    sizeof(records[i].permutations));
+    memcpy(records[i].round_size,      indexers[i]->round_size,      sizeof(records[i].round_size));
+    records[i].rounds = indexers[i]->rounds;
+  }
+  if (cursor.valid) {
+    file_write(&cursor, records, count*sizeof(struct file_indexer_s));
+  }
+  free(records);
+
+  visit_global_tables(save_table, &cursor);
+  for(uint32_t i=0; cursor.valid && i<count; ++i) {
+    visit_indexer_tables((hand_indexer_t *)indexers[i], save_table, &cursor);
+  }
+
+  header.checksum = cursor.checksum;
+  cursor.valid   &= fseek(cursor.file, 0, SEEK_SET) == 0 && fwrite(&header, 1, sizeof(header), cursor.file) == sizeof(header);
+  cursor.valid   &= fclose(cursor.file) == 0;
+
+  if (!cursor.valid) {
+    remove(path);
+  }
+  return cursor.valid;
+}
+
+static uint8_t * map_file(const char * path, size_t * size) {
+#ifdef _WIN32
+  HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+  if (file == INVALID_HANDLE_VALUE) {
+    return NULL;
+  }
+  LARGE_INTEGER file_size;
+  HANDLE mapping = NULL;
+  if (GetFileSizeEx(file, &file_size) && file_size.QuadPart > 0) {
+    mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+  }
+  CloseHandle(file);
+  if (!mapping) {
+    return NULL;
+  }
+  uint8_t * base = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+  CloseHandle(mapping);
+  *size = (size_t)file_size.QuadPart;
+  return base;
+#else
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    return NULL;
+  }
+  struct stat st;
+  void * base = MAP_FAILED;
+  if (fstat(fd, &st) == 0 && st.st_size > 0) {
+    base = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  }
+  close(fd);
+  if (base == MAP_FAILED) {
+    return NULL;
+  }
+  *size = st.st_size;
+  return base;
+#endif
+}
+
+static void unmap_file(uint8_t * base, size_t size) {
+#ifdef _WIN32
+  UnmapViewOfFile(base);
+#else
+  munmap(base, size);
+#endif
+}
+
+bool hand_index_map_memory(const void * data, size_t size, bool verify, uint32_t capacity, hand_indexer_t * indexers, uint32_t * count) {
+  uint8_t * base = (uint8_t *)data;
+
+  struct file_header_s header;
+  bool valid = size >= file_align(sizeof(header));
+  if (valid) {
+    memcpy(&header, base, sizeof(header));
+    valid = !memcmp(header.magic, FILE_MAGIC, sizeof(header.magic)) &&
+      header.version == FILE_VERSION &&
+      header.endian == FILE_ENDIAN &&
+      header.size == size &&
+      header.indexers <= capacity &&
+      file_align(sizeof(header))+file_align(header.indexers*sizeof(struct file_indexer_s)) <= size;
+  }
+  if (valid && verify) {
+    valid = file_checksum(0xcbf29ce484222325ull, base+file_align(sizeof(header)), size-file_align(sizeof(header))) == header.checksum;
+  }
+
+  struct file_cursor_s cursor = {.base = base, .offset = file_align(sizeof(header)), .size = size, .valid = valid};
+  const struct file_indexer_s * records = (const struct file_indexer_s *)(base+cursor.offset);
+  if (valid) {
+    cursor.offset += file_align(header.indexers*sizeof(struct file_indexer_s));
+  }
+
+  /* the computed tables are identical, so keep them if hand_index_ctor already ran */
+  bool use_global_tables = !suit_permutations;
+  cursor.assign = use_global_tables;
+  visit_global_tables(map_table, &cursor);
+  
+  cursor.assign = true;
+  for(uint32_t i=0; cursor.valid && i<header.indexers; ++i) {
+    hand_indexer_t * indexer = &indexers[i];
+    memset(indexer, 0, sizeof(hand_indexer_t));
+
+    if (records[i].rounds == 0 || records[i].rounds > MAX_ROUNDS) {
+      cursor.valid = false;
+      break;
+    }
+    memcpy(indexer->cards_per_round, records[i].cards_per_round, MAX_ROUNDS);
+    memcpy(indexer->round_start,     records[i].round_start,     MAX_ROUNDS);
+    memcpy(indexer->configurations,  records[i].configurations,  sizeof(indexer->configurations));
+    memcpy(indexer->permutations,    records[i].permutations,    sizeof(indexer->permutations));
+    memcpy(indexer->round_size,      records[i].round_size,      sizeof(indexer->round_size));
+    indexer->rounds = records[i].rounds;
+    indexer->mapped = true;
+    set_directory_shift(indexer);
+
+    visit_indexer_tables(indexer, map_table, &cursor);
+  }
+
+  if (!cursor.valid) {
+    /* nothing may point into an invalid image */
+    if (use_global_tables) {
+      nth_unset = NULL; equal = NULL; nCr_ranks = NULL; rank_set_to_index = NULL;
+      index_to_rank_set = NULL; suit_permutations = NULL;
+    }
+    return false;
+  }
+
+  *count = header.indexers;
+  return true;
+}
+
+bool hand_index_map(const char * path, bool verify, uint32_t capacity, hand_indexer_t * indexers, uint32_t * count) {
+  size_t size;
+  uint8_t * base = map_file(path, &size);
+  if (!base) {
+    return false;
+  }
+
+  if (!hand_index_map_memory(base, size, verify, capacity, indexers, count)) {
+    unmap_file(base, size);
+    return false;
+  }
+  return true;
+}
+
+static size_t table_bytes(hand_index_t hands, uint32_t bits) {
+  return (hands*bits+7)/8;
+}
+
+static void table_header(const char * magic, const hand_indexer_t * indexer, const hand_indexer_t * next, uint32_t bits, struct table_header_s * header) {
+  memset(header, 0, sizeof(*header));
+  memcpy(header->magic, magic, sizeof(header->magic));
+  header->version = TABLE_VERSION;
+  header->endian  = FILE_ENDIAN;
+  memcpy(header->cards_per_round,      indexer->cards_per_round, MAX_ROUNDS);
+  memcpy(header->next_cards_per_round, next->cards_per_round,    MAX_ROUNDS);
+  header->rounds      = indexer->rounds;
+  header->next_rounds = next->rounds;
+  header->bits        = bits;
+  header->hands       = indexer->round_size[indexer->rounds-1];
+  /* at least 8 bytes of padding follow the entries, so that any entry is one 8 byte load */
+  header->size        = file_align(sizeof(*header))+file_align(table_bytes(header->hands, bits)+8);
+}
+
+static bool table_save(const char * path, const char * magic, const hand_indexer_t * indexer, const hand_indexer_t * next, uint32_t bits, const void * table) {
+  struct table_header_s header; table_header(magic, indexer, next, bits, &header);
+
+  struct file_cursor_s cursor = {0};
+  cursor.file  = fopen(path, "wb");
+  cursor.valid = cursor.file != NULL;
+  if (!cursor.valid) {
+    return false;
+  }
+
+  file_write(&cursor, &header, sizeof(header));
+  cursor.checksum = 0xcbf29ce484222325ull;
+  size_t bytes = table_bytes(header.hands, bits);
+  file_write(&cursor, table, bytes);
+  if (file_align(bytes+8) > file_align(bytes)) {
+    static const uint8_t padding[FILE_ALIGNMENT] = {0};
+    file_write(&cursor, padding, FILE_ALIGNMENT);
+  }
+
+  header.checksum = cursor.checksum;
+  cursor.valid   &= fseek(cursor.file, 0, SEEK_SET) == 0 && fwrite(&header, 1, sizeof(header), cursor.file) == sizeof(header);
+  cursor.valid   &= fclose(cursor.file) == 0;
+
+  if (!cursor.valid) {
+    remove(path);
+  }
+  return cursor.valid;
+}
+
+/* bits is the width of the table's entries, or 0 for whichever width the file has */
+static const void * table_map(const char * path, const char * magic, const hand_indexer_t * indexer, const hand_indexer_t * next, uint32_t * bits, bool verify) {
+  size_t size;
+  uint8_t * base = map_file(path, &size);
+  if (!base) {
+    return NULL;
+  }
+
+  struct table_header_s expected, header;
+  bool valid = size >= sizeof(header);
+  if (valid) {
+    memcpy(&header, base, sizeof(header));
+    table_header(magic, indexer, next, *bits ? *bits : header.bits, &expected);
+    expected.checksum = header.checksum;
+    valid = size == expected.size && !memcmp(&header, &expected, sizeof(header));
+  }
+  if (valid && verify) {
+    valid = file_checksum(0xcbf29ce484222325ull, base+file_align(sizeof(header)), size-file_align(sizeof(header))) == header.checksum;
+  }
+
+  if (!valid) {
+    unmap_file(base, size);
+    return NULL;
+  }
+  *bits = header.bits;
+  return base+file_align(sizeof(header));
+}
+
+static void table_unmap(const void * table) {
+  if (table) {
+    uint8_t * base = (uint8_t *)table-file_align(sizeof(struct table_header_s));
+    struct table_header_s header; memcpy(&header, base, sizeof(header));
+    unmap_file(base, header.size);
+  }
+}
+
+bool hand_successors_save(const char * path, const hand_indexer_t * indexer, const hand_indexer_t * next, const uint32_t successors[]) {
+  return table_save(path, SUCCESSOR_MAGIC, indexer, next, 32*CARDS, successors);
+}
+
+const uint32_t * hand_successors_map(const char * path, const hand_indexer_t * indexer, const hand_indexer_t * next, bool verify) {
+  uint32_t bits = 32*CARDS;
+  return table_map(path, SUCCESSOR_MAGIC, indexer, next, &bits, verify);
+}
+
+void hand_successors_unmap(const uint32_t successors[]) {
+  table_unmap(successors);
+}
+
+bool hand_projections_save(const char * path, const hand_indexer_t * indexer, const hand_indexer_t * target, uint32_t bits, const void * projections) {
+  return table_save(path, PROJECTION_MAGIC, indexer, target, bits, projections);
+}
+
+const void * hand_projections_map(const char * path, const hand_indexer_t * indexer, const hand_indexer_t * target, uint32_t * bits, bool verify) {
+  *bits = 0;
+  return table_map(path, PROJECTION_MAGIC, indexer, target, bits, verify);
+}
+
+void hand_projections_unmap(const void * projections) {
+  table_unmap(projections);
+}
@@ -1,18 +1,89 @@
 #include "hand_isomorphism.h"
 
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <mutex>
+#include <new>
+#include <thread>
 #include <vector>
 
 extern "C"{
+#include "deck.h"
 #include "hand_index.h"
 }
 
+#include "hand_isomorphism.hpp"
+
+#ifdef HAND_ISOMORPHISM_STATIC_TABLES
+// Image of hand_isomorphism_save_tables, generated at build time by tools/generate_tables.cpp.
+extern const uint64_t hand_isomorphism_builtin_tables[];
+extern const size_t hand_isomorphism_builtin_tables_size;
+#endif
+
+class MappedIndexers{
+public:
+    static MappedIndexers& get_instance() {
+        static MappedIndexers instance;
+        return instance;
+    }
+
+    bool map(const char *path, bool verify){
+        std::vector<hand_indexer_t> mapped(max_indexers);
+        uint32_t count = 0;
+        if (!hand_index_map(path, verify, max_indexers, mapped.data(), &count)) {
+            return false;
+        }
+        indexers.insert(indexers.end(), mapped.begin(), mapped.begin() + count);
+        return true;
+    }
+
+    // A mapped indexer with the given shape, or nullptr if none was mapped.
+    const hand_indexer_t *find(const std::vector<uint8_t>& cards_per_round) const{
+        for (const auto &indexer : indexers)
+        {
+            if (indexer.rounds == cards_per_round.size() &&
+                std::equal(cards_per_round.begin(), cards_per_round.end(), indexer.cards_per_round)) {
+                return &indexer;
+            }
+        }
+        return nullptr;
+    }
+
+    MappedIndexers(const MappedIndexers&) = delete;
+    MappedIndexers& operator=(const MappedIndexers&) = delete;
+    MappedIndexers(MappedIndexers&&) = delete;
+    MappedIndexers& operator=(MappedIndexers&&) = delete;
+
+private:
+    MappedIndexers() {
+#ifdef HAND_ISOMORPHISM_STATIC_TABLES
+        std::vector<hand_indexer_t> builtin(max_indexers);
+        uint32_t count = 0;
+        if (hand_index_map_memory(hand_isomorphism_builtin_tables, hand_isomorphism_builtin_tables_size,
+                                  false, max_indexers, builtin.data(), &count)) {
+            indexers.assign(builtin.begin(), builtin.begin() + count);
+        }
+#endif
+    }
+
+    static constexpr uint32_t max_indexers = 64;
+    std::vector<hand_indexer_t> indexers;
+};
+
 struct HandIndexers{
     HandIndexers(const std::vector<std::vector<uint8_t>>& cards_per_street):
         cards_per_street(cards_per_street){
         indexers.resize(cards_per_street.size());
         for (size_t i = 0; i < cards_per_street.size(); i++)
         {
-            hand_indexer_init(cards_per_street[i].size(), cards_per_street[i].data(), &indexers[i]);
+            // Mapped indexers are shared as is; freeing them is a no-op.
+            const hand_indexer_t *mapped = MappedIndexers::get_instance().find(cards_per_street[i]);
+            if (mapped) {
+                indexers[i] = *mapped;
+            } else {
+                hand_indexer_init(cards_per_street[i].size(), cards_per_street[i].data(), &indexers[i]);
+            }
         }
     }
     ~HandIndexers(){
@@ -25,6 +96,8 @@ struct HandIndexers{
     std::vector<hand_indexer_t> indexers;
 };
 
+static void select_template_kernels();
+
 class HandIndexerBuilder{
 public:
     static HandIndexerBuilder& get_instance() {
@@ -43,10 +116,85 @@ public:
 
 private:
     HandIndexerBuilder() {
+        // Mapped or built-in tables replace the global tables hand_index_ctor computes.
+        MappedIndexers::get_instance();
         hand_index_ctor();
+        select_template_kernels();
     }
 };
 
+// Compile time indexers for the four streets of a recall type, over the streets' runtime indexers.
+template <class Preflop, class Flop, class Turn, class River>
+struct StreetIndexers{
+    static std::vector<std::vector<uint8_t>> cards_per_street(){
+        return {Preflop::shape(), Flop::shape(), Turn::shape(), River::shape()};
+    }
+
+    explicit StreetIndexers(const HandIndexers& indexers):
+        preflop(&indexers.indexers[0]), flop(&indexers.indexers[1]),
+        turn(&indexers.indexers[2]), river(&indexers.indexers[3]){
+    }
+
+    hand_index_t index_last(int street, const uint8_t *cards) const{
+        switch (street) {
+            case 0:  return preflop.index_last(cards);
+            case 1:  return flop.index_last(cards);
+            case 2:  return turn.index_last(cards);
+            default: return river.index_last(cards);
+        }
+    }
+
+    hand_index_t index_last_masks(int street, const uint64_t *masks) const{
+        switch (street) {
+            case 0:  return preflop.index_last_masks(masks);
+            case 1:  return flop.index_last_masks(masks);
+            case 2:  return turn.index_last_masks(masks);
+            default: return river.index_last_masks(masks);
+        }
+    }
+
+    void canonicalize(int street, const uint8_t *cards, uint8_t *canonical, uint8_t suit_permutation[SUITS]) const{
+        switch (street) {
+            case 0:  return preflop.canonicalize(cards, canonical, suit_permutation);
+            case 1:  return flop.canonicalize(cards, canonical, suit_permutation);
+            case 2:  return turn.canonicalize(cards, canonical, suit_permutation);
+            default: return river.canonicalize(cards, canonical, suit_permutation);
+        }
+    }
+
+    // Hands of a street are stored back to back, each holding every card of its last round.
+    void canonicalize_batch(int street, const uint8_t *cards, size_t n, uint8_t *canonical, uint8_t *suit_permutations) const{
+        const hand_indexer_t *indexer = street == 0 ? preflop.get() : street == 1 ? flop.get() : street == 2 ? turn.get() : river.get();
+        const size_t hand_size = indexer->round_start[indexer->rounds - 1] + indexer->cards_per_round[indexer->rounds - 1];
+        for (size_t i = 0; i < n; i++)
+        {
+            canonicalize(street, cards + i * hand_size, canonical + i * hand_size, suit_permutations + i * SUITS);
+        }
+    }
+
+    template <int Street>
+    using Indexer = std::tuple_element_t<Street, std::tuple<Preflop, Flop, Turn, River>>;
+
+    // The compile time indexer of a street, for a hand_iso_street's kernel.
+    const void *kernel(int street) const{
+        switch (street) {
+            case 0:  return &preflop;
+            case 1:  return &flop;
+            case 2:  return &turn;
+            default: return &river;
+        }
+    }
+
+    const Preflop preflop;
+    const Flop flop;
+    const Turn turn;
+    const River river;
+};
+
+template <hand_recall Recall>
+using RecallStreets = StreetIndexers<hand_iso::StreetIndexer<Recall, 0>, hand_iso::StreetIndexer<Recall, 1>,
+                                     hand_iso::StreetIndexer<Recall, 2>, hand_iso::StreetIndexer<Recall, 3>>;
+
 class ImperfectRecall{
 public:
     static ImperfectRecall& get_instance() {
@@ -59,10 +207,13 @@ public:
     ImperfectRecall(ImperfectRecall&&) = delete;
     ImperfectRecall& operator=(ImperfectRecall&&) = delete;
 
+    using Streets = RecallStreets<IMPERFECT_RECALL>;
+
     HandIndexers indexers;
+    const Streets streets;
 private:
     ImperfectRecall()
-        : indexers(HandIndexerBuilder::get_instance().build({{2},{2,3},{2,4},{2,5}})) {
+        : indexers(HandIndexerBuilder::get_instance().build(Streets::cards_per_street())), streets(indexers) {
     }
 };
 
@@ -78,10 +229,13 @@ public:
     PerfectRecall(PerfectRecall&&) = delete;
     PerfectRecall& operator=(PerfectRecall&&) = delete;
 
+    using Streets = RecallStreets<PERFECT_RECALL>;
+
     HandIndexers indexers;
+    const Streets streets;
 private:
     PerfectRecall()
-        : indexers(HandIndexerBuilder::get_instance().build({{2},{2,3},{2,3,1},{2,3,1,1}})) {
+        : indexers(HandIndexerBuilder::get_instance().build(Streets::cards_per_street())), streets(indexers) {
     }
 };
 
@@ -97,10 +251,13 @@ public:
     FlopRecall(FlopRecall&&) = delete;
     FlopRecall& operator=(FlopRecall&&) = delete;
 
+    using Streets = RecallStreets<FLOP_RECALL>;
+
     HandIndexers indexers;
+    const Streets streets;
 private:
     FlopRecall()
-        : indexers(HandIndexerBuilder::get_instance().build({{2},{2,3},{2,3,1},{2,3,2}})) {
+        : indexers(HandIndexerBuilder::get_instance().build(Streets::cards_per_street())), streets(indexers) {
     }
 };
 
@@ -116,13 +273,625 @@ public:
     BoardImperfectRecall(BoardImperfectRecall&&) = delete;
     BoardImperfectRecall& operator=(BoardImperfectRecall&&) = delete;
 
+    using Streets = RecallStreets<BOARD_IMPERFECT_RECALL>;
+
     HandIndexers indexers;
+    const Streets streets;
 private:
     BoardImperfectRecall()
-        : indexers(HandIndexerBuilder::get_instance().build({{1},{3},{4},{5}})) {
+        : indexers(HandIndexerBuilder::get_instance().build(Streets::cards_per_street())), streets(indexers) {
+    }
+};
+
+class BoardFirstRecall{
+public:
+    static BoardFirstRecall& get_instance() {
+        static BoardFirstRecall instance;
+        return instance;
+    }
+
+    BoardFirstRecall(const BoardFirstRecall&) = delete;
+    BoardFirstRecall& operator=(const BoardFirstRecall&) = delete;
+    BoardFirstRecall(BoardFirstRecall&&) = delete;
+    BoardFirstRecall& operator=(BoardFirstRecall&&) = delete;
+
+    using Streets = RecallStreets<BOARD_FIRST_RECALL>;
+
+    HandIndexers indexers;
+    const Streets streets;
+private:
+    BoardFirstRecall()
+        : indexers(HandIndexerBuilder::get_instance().build(Streets::cards_per_street())), streets(indexers) {
+    }
+};
+
+static const HandIndexers& recall_indexers(hand_recall recall){
+    switch (recall) {
+        case IMPERFECT_RECALL:   return ImperfectRecall::get_instance().indexers;
+        case PERFECT_RECALL:     return PerfectRecall::get_instance().indexers;
+        case FLOP_RECALL:        return FlopRecall::get_instance().indexers;
+        case BOARD_FIRST_RECALL: return BoardFirstRecall::get_instance().indexers;
+        default:                 return BoardImperfectRecall::get_instance().indexers;
+    }
+}
+
+// Index a seven card hand under every recall type at once. See index_all_recalls.
+static inline void index_all_recalls_kernel(const ImperfectRecall::Streets &imperfect, const PerfectRecall::Streets &perfect_streets,
+                                            const FlopRecall::Streets &flop_streets, const uint8_t cards[7], all_indices *out){
+    const auto &perfect = perfect_streets.river;
+    const auto &flop = flop_streets.river;
+
+    // Rank set of each suit dealt on each street, decoded once for every indexer.
+    static const int card_street[7] = {0, 0, 1, 1, 1, 2, 3};
+    uint32_t ranks[4][SUITS] = {};
+    for (int i = 0; i < 7; i++)
+    {
+        ranks[card_street[i]][deck_get_suit(cards[i])] |= 1u << deck_get_rank(cards[i]);
+    }
+    uint32_t turn_board[SUITS], river_board[SUITS], turn_and_river[SUITS];
+    for (int i = 0; i < SUITS; i++)
+    {
+        turn_board[i] = ranks[1][i] | ranks[2][i];
+        river_board[i] = turn_board[i] | ranks[3][i];
+        turn_and_river[i] = ranks[2][i] | ranks[3][i];
+    }
+
+    // Every recall type shares the preflop and flop shapes, and flop recall shares
+    // perfect recall's turn, so one perfect recall pass covers those streets. The
+    // remaining shapes resume from the shared preflop or flop state.
+    hand_indexer_state_t state, preflop, flop_state;
+    perfect.state_init(&state);
+    out->perfect_recall[0] = perfect.next_round_ranks<0>(ranks[0], &state);
+    preflop = state;
+    out->perfect_recall[1] = perfect.next_round_ranks<1>(ranks[1], &state);
+    flop_state = state;
+    out->perfect_recall[2] = perfect.next_round_ranks<2>(ranks[2], &state);
+    out->perfect_recall[3] = perfect.next_round_ranks<3>(ranks[3], &state);
+
+    state = preflop;
+    out->imperfect_recall[2] = imperfect.turn.next_round_ranks<1>(turn_board, &state);
+    state = preflop;
+    out->imperfect_recall[3] = imperfect.river.next_round_ranks<1>(river_board, &state);
+    state = flop_state;
+    out->flop_recall[3] = flop.next_round_ranks<2>(turn_and_river, &state);
+
+    out->imperfect_recall[0] = out->flop_recall[0] = out->perfect_recall[0];
+    out->imperfect_recall[1] = out->flop_recall[1] = out->perfect_recall[1];
+    out->flop_recall[2] = out->perfect_recall[2];
+}
+
+// The compile time indexers' entry points, compiled for each instruction set flavour of the
+// kernels in hand_index.c and following its selection, so that they also inline into code
+// built for the cpu. They take the streets rather than reaching the singletons so that
+// flattening does not pull the singletons' construction into every flavour.
+template <class Streets>
+struct StreetKernels{
+    hand_index_t (*index_last)(const Streets &streets, int street, const uint8_t *cards);
+    hand_index_t (*index_last_masks)(const Streets &streets, int street, const uint64_t *masks);
+    void (*canonicalize)(const Streets &streets, int street, const uint8_t *cards, uint8_t *canonical, uint8_t *suit_permutation);
+    void (*canonicalize_batch)(const Streets &streets, int street, const uint8_t *cards, size_t n,
+                               uint8_t *canonical, uint8_t *suit_permutations);
+    decltype(hand_iso_street::index) street_index[4];
+    decltype(hand_iso_street::index_masks) street_index_masks[4];
+};
+
+struct TemplateKernels{
+    const char *name;
+    StreetKernels<ImperfectRecall::Streets> imperfect;
+    StreetKernels<PerfectRecall::Streets> perfect;
+    StreetKernels<FlopRecall::Streets> flop;
+    StreetKernels<BoardImperfectRecall::Streets> board_imperfect;
+    StreetKernels<BoardFirstRecall::Streets> board_first;
+    void (*perfect_index_all)(const PerfectRecall::Streets &streets, const uint8_t *cards, uint64_t out[4]);
+    hand_index_t (*perfect_next_street)(const PerfectRecall::Streets &streets, hand_indexer_state_t *state, const uint8_t *cards);
+    void (*index_all_recalls)(const ImperfectRecall::Streets &imperfect, const PerfectRecall::Streets &perfect,
+                              const FlopRecall::Streets &flop, const uint8_t cards[7], all_indices *out);
+};
+
+#define DEFINE_TEMPLATE_KERNELS(flavour, attributes, bmi2) \
+    namespace flavour##_kernels{ \
+        template <class Streets> \
+        attributes hand_index_t index_last(const Streets &streets, int street, const uint8_t *cards){ \
+            return streets.index_last(street, cards); \
+        } \
+        template <class Streets> \
+        attributes hand_index_t index_last_masks(const Streets &streets, int street, const uint64_t *masks){ \
+            return streets.index_last_masks(street, masks); \
+        } \
+        template <class Streets> \
+        attributes void canonicalize(const Streets &streets, int street, const uint8_t *cards, uint8_t *canonical, uint8_t *suit_permutation){ \
+            streets.canonicalize(street, cards, canonical, suit_permutation); \
+        } \
+        template <class Streets> \
+        attributes void canonicalize_batch(const Streets &streets, int street, const uint8_t *cards, size_t n, \
+                                           uint8_t *canonical, uint8_t *suit_permutations){ \
+            streets.canonicalize_batch(street, cards, n, canonical, suit_permutations); \
+        } \
+        template <class Kernel> \
+        attributes uint64_t street_index(const hand_iso_street *street, const uint8_t *cards){ \
+            return static_cast<const Kernel*>(street->kernel)->index_last(cards); \
+        } \
+        template <class Kernel> \
+        attributes uint64_t street_index_masks(const hand_iso_street *street, const uint64_t *masks){ \
+            return static_cast<const Kernel*>(street->kernel)->index_last_masks(masks); \
+        } \
+        template <class Streets> \
+        constexpr StreetKernels<Streets> street_kernels(){ \
+            return {index_last<Streets>, index_last_masks<Streets>, canonicalize<Streets>, canonicalize_batch<Streets>, \
+                    {street_index<typename Streets::template Indexer<0>>, street_index<typename Streets::template Indexer<1>>, \
+                     street_index<typename Streets::template Indexer<2>>, street_index<typename Streets::template Indexer<3>>}, \
+                    {street_index_masks<typename Streets::template Indexer<0>>, street_index_masks<typename Streets::template Indexer<1>>, \
+                     street_index_masks<typename Streets::template Indexer<2>>, street_index_masks<typename Streets::template Indexer<3>>}}; \
+        } \
+        attributes void perfect_index_all(const PerfectRecall::Streets &streets, const uint8_t *cards, uint64_t out[4]){ \
+            streets.river.index_all(cards, out); \
+        } \
+        attributes hand_index_t perfect_next_street(const PerfectRecall::Streets &streets, hand_indexer_state_t *state, const uint8_t *cards){ \
+            return streets.river.next_round(cards, state); \
+        } \
+        attributes void index_all_recalls(const ImperfectRecall::Streets &imperfect, const PerfectRecall::Streets &perfect, \
+                                          const FlopRecall::Streets &flop, const uint8_t cards[7], all_indices *out){ \
+            index_all_recalls_kernel(imperfect, perfect, flop, cards, out); \
+        } \
+    }
+
+HAND_INDEX_FLAVOURS(DEFINE_TEMPLATE_KERNELS)
+
+#undef DEFINE_TEMPLATE_KERNELS
+
+#define TEMPLATE_KERNELS_ENTRY(flavour, attributes, bmi2) \
+    {#flavour, \
+     flavour##_kernels::street_kernels<ImperfectRecall::Streets>(), \
+     flavour##_kernels::street_kernels<PerfectRecall::Streets>(), \
+     flavour##_kernels::street_kernels<FlopRecall::Streets>(), \
+     flavour##_kernels::street_kernels<BoardImperfectRecall::Streets>(), \
+     flavour##_kernels::street_kernels<BoardFirstRecall::Streets>(), \
+     flavour##_kernels::perfect_index_all, flavour##_kernels::perfect_next_street, flavour##_kernels::index_all_recalls},
+
+static const TemplateKernels template_kernels_table[] = {
+    HAND_INDEX_FLAVOURS(TEMPLATE_KERNELS_ENTRY)
+};
+
+#undef TEMPLATE_KERNELS_ENTRY
+
+static const TemplateKernels *find_template_kernels(const char *name){
+    for (const auto &kernels : template_kernels_table)
+    {
+        if (std::strcmp(kernels.name, name) == 0) {
+            return &kernels;
+        }
+    }
+    return nullptr;
+}
+
+// The kernels of the flavour hand_index.c selected, looked up on first use, or the ones
+// hand_isomorphism_use_kernels chose. Threads making their first calls at once may all look
+// the flavour up, but only one stores it.
+static std::atomic<const TemplateKernels*> selected_template_kernels(nullptr);
+
+static const TemplateKernels &template_kernels(){
+    const TemplateKernels *kernels = selected_template_kernels.load(std::memory_order_acquire);
+    if (!kernels) {
+        const TemplateKernels *selected = find_template_kernels(hand_index_kernels());
+        if (selected_template_kernels.compare_exchange_strong(kernels, selected, std::memory_order_acq_rel)) {
+            kernels = selected;
+        }
+    }
+    return *kernels;
+}
+
+static void select_template_kernels(){
+    template_kernels();
+}
+
+// Visits every index of one round of an indexer with a pool of workers. The index space
+// is cut into chunks that never cross a configuration, so a chunk's hands share their
+// suit structure, and each worker starts with a contiguous run of chunks holding an equal
+// share of the indices. A worker that empties its run steals chunks from the back of the
+// others' runs, leaving their owners to carry on in order from the front.
+class CanonicalSweep{
+public:
+    static constexpr hand_index_t block_size = 1024;
+
+    CanonicalSweep(const hand_indexer_t *indexer, uint32_t round, unsigned threads):
+        indexer(indexer), round(round), queues(threads){
+        const hand_index_t size = hand_indexer_size(indexer, round);
+        const hand_index_t chunk_size = std::max(block_size, (size + threads * chunks_per_thread - 1) / (threads * chunks_per_thread));
+        for (uint32_t configuration = 0; configuration < indexer->configurations[round]; configuration++)
+        {
+            hand_index_t first = indexer->configuration_to_offset[round][configuration];
+            hand_index_t last = configuration + 1 < indexer->configurations[round] ?
+                indexer->configuration_to_offset[round][configuration + 1] : size;
+            for (; first < last; first += std::min(chunk_size, last - first))
+            {
+                chunks.push_back({first, std::min(chunk_size, last - first)});
+            }
+        }
+
+        for (size_t thread = 0, chunk = 0; thread < queues.size(); thread++)
+        {
+            const hand_index_t share = size * (thread + 1) / threads;
+            queues[thread].begin = chunk;
+            while (chunk < chunks.size() && (thread + 1 == threads || chunks[chunk].first < share)) {
+                chunk++;
+            }
+            queues[thread].end = chunk;
+        }
+    }
+
+    void run(canonical_hands_callback callback, void *user_data){
+        std::vector<std::thread> workers;
+        for (unsigned thread = 1; thread < queues.size(); thread++)
+        {
+            workers.emplace_back(&CanonicalSweep::work, this, thread, callback, user_data);
+        }
+        work(0, callback, user_data);
+        for (auto &worker : workers)
+        {
+            worker.join();
+        }
+    }
+
+private:
+    static constexpr hand_index_t chunks_per_thread = 16;
+
+    struct Chunk{
+        hand_index_t first, count;
+    };
+
+    struct alignas(64) Queue{
+        std::mutex mutex;
+        size_t begin = 0, end = 0;
+    };
+
+    bool take(unsigned thread, Chunk *chunk){
+        {
+            Queue &own = queues[thread];
+            std::lock_guard<std::mutex> lock(own.mutex);
+            if (own.begin < own.end) {
+                *chunk = chunks[own.begin++];
+                return true;
+            }
+        }
+        for (size_t i = 1; i < queues.size(); i++)
+        {
+            Queue &victim = queues[(thread + i) % queues.size()];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (victim.begin < victim.end) {
+                *chunk = chunks[--victim.end];
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void work(unsigned thread, canonical_hands_callback callback, void *user_data){
+        const uint32_t hand_size = indexer->round_start[round] + indexer->cards_per_round[round];
+        std::vector<uint8_t> cards(block_size * hand_size);
+        hand_unindex_iterator_t iterator;
+        Chunk chunk;
+        while (take(thread, &chunk)) {
+            hand_unindex_iterator_init(indexer, round, chunk.first, &iterator);
+            for (hand_index_t first = chunk.first, last = chunk.first + chunk.count; first < last; first += block_size)
+            {
+                const size_t n = std::min(block_size, last - first);
+                for (size_t i = 0; i < n; i++)
+                {
+                    std::copy_n(iterator.cards, hand_size, &cards[i * hand_size]);
+                    hand_unindex_iterator_next(&iterator);
+                }
+                callback(static_cast<int>(thread), first, n, cards.data(), user_data);
+            }
+        }
+    }
+
+    const hand_indexer_t *indexer;
+    const uint32_t round;
+    std::vector<Chunk> chunks;
+    std::vector<Queue> queues;
+};
+
+// Resolves the streets of a recall type into a context. Building the recall type also
+// selects the kernels, so they are read after it.
+template <class Recall>
+static void init_ctx(hand_iso_ctx *ctx, StreetKernels<typename Recall::Streets> TemplateKernels::*member){
+    const Recall &recall = Recall::get_instance();
+    const StreetKernels<typename Recall::Streets> &kernels = template_kernels().*member;
+    for (int street = 0; street < 4; street++)
+    {
+        hand_iso_street &handle = ctx->streets[street];
+        handle.indexer = &recall.indexers.indexers[street];
+        handle.round = recall.indexers.cards_per_street[street].size() - 1;
+        handle.size = hand_indexer_size(handle.indexer, handle.round);
+        handle.index = kernels.street_index[street];
+        handle.index_masks = kernels.street_index_masks[street];
+        handle.kernel = recall.streets.kernel(street);
+    }
+}
+
+// The indexers of a street and of the next, whose successor table maps the first's indices
+// and a card to the second's.
+struct SuccessorStreets{
+    SuccessorStreets(hand_recall recall, int street):
+        indexer(nullptr), next(nullptr), round(0), size(0){
+        if (street == 1 || street == 2) {
+            const HandIndexers &indexers = recall_indexers(recall);
+            indexer = &indexers.indexers[street];
+            next = &indexers.indexers[street + 1];
+            round = indexers.cards_per_street[street].size() - 1;
+            size = hand_indexer_size(indexer, round);
+        }
+    }
+
+    bool valid() const{
+        return indexer && hand_successors(indexer, next, nullptr, 0, nullptr);
+    }
+
+    const hand_indexer_t *indexer, *next;
+    uint32_t round;
+    hand_index_t size;
+};
+
+// The perfect recall indexer of a street and a recall type's indexer of the same street,
+// whose projection table maps the first's indices to the second's. Board first recall hands
+// hold the same cards with the hole cards last.
+struct ProjectionStreets{
+    ProjectionStreets(hand_recall recall, int street):
+        indexer(&PerfectRecall::get_instance().indexers.indexers[street]),
+        target(&recall_indexers(recall).indexers[street]),
+        round(indexer->rounds - 1), size(hand_indexer_size(indexer, round)),
+        hole_cards_last(recall == BOARD_FIRST_RECALL){
+    }
+
+    bool valid() const{
+        const uint32_t last = target->rounds - 1;
+        return target->round_start[last] + target->cards_per_round[last] == indexer->round_start[round] + indexer->cards_per_round[round];
+    }
+
+    // The bits of the largest index of the target's street.
+    uint32_t bits() const{
+        uint32_t bits = 1;
+        for (hand_index_t largest = hand_indexer_size(target, target->rounds - 1) - 1; largest >> bits; bits++) {
+        }
+        return bits;
+    }
+
+    const hand_indexer_t *indexer, *target;
+    uint32_t round;
+    hand_index_t size;
+    bool hole_cards_last;
+};
+
+// Board cards of a board first recall hand on each street, which its 2 hole cards follow.
+static const int board_first_board_cards[4] = {0, 3, 4, 5};
+
+// The board first recall index of a board.
+static uint64_t board_first_board_index(int street, const uint8_t *board){
+    if (street == 0) {
+        return 0;
+    }
+    const hand_indexer_t *indexer = &BoardFirstRecall::get_instance().indexers.indexers[street];
+    hand_indexer_state_t state;
+    hand_indexer_state_init(indexer, &state);
+    return hand_index_next_round(indexer, board, &state);
+}
+
+// The canonical board of a board first recall board index.
+static bool board_first_board(int street, uint64_t board_index, uint8_t *board){
+    if (street == 0) {
+        return board_index == 0;
+    }
+    return hand_unindex(&BoardFirstRecall::get_instance().indexers.indexers[street], 0, board_index, board);
+}
+
+// The hole cards of board first recall hands with a given board. Relabelling the suits of the
+// board onto itself only exchanges suits holding the same board ranks, so the hole cards' class
+// is given by the classes of such suits holding them, and by their ranks renumbered among the
+// ranks their suits have left. Classes are ordered by their board ranks, which relabelling
+// preserves, and the hole indices of each class take the cases in turn: both cards in one suit
+// of the class, in two suits of the class, and in the class and a later one. The classes past
+// the last hold no suits and leave no ranks, so the sums over them run over every suit without
+// branching on the board.
+struct BoardHoles{
+    BoardHoles(int street, const uint8_t *board):
+        suit_ranks{}, class_suits{}, class_left{}{
+        for (int i = 0; i < board_first_board_cards[street]; i++)
+        {
+            suit_ranks[deck_get_suit(board[i])] |= 1u << deck_get_rank(board[i]);
+        }
+        // A suit's class counts the distinct board rank sets below its own.
+        bool first[SUITS];
+        for (int suit = 0; suit < SUITS; suit++)
+        {
+            first[suit] = true;
+            for (int other = 0; other < suit; other++)
+            {
+                first[suit] &= suit_ranks[other] != suit_ranks[suit];
+            }
+        }
+        for (int suit = 0; suit < SUITS; suit++)
+        {
+            int c = 0;
+            for (int other = 0; other < SUITS; other++)
+            {
+                c += first[other] & (suit_ranks[other] < suit_ranks[suit]);
+            }
+            of[suit] = c;
+            class_suits[c]++;
+            class_left[c] = RANKS - deck_count_ranks(suit_ranks[suit]);
+        }
+    }
+
+    // Hole indices with both cards in one suit of a class, and in two suits of it.
+    uint64_t one_suit(int c) const{
+        return class_left[c] * (class_left[c] - 1) / 2;
+    }
+
+    uint64_t two_suits(int c) const{
+        return (class_suits[c] > 1) * class_left[c] * (class_left[c] + 1) / 2;
+    }
+
+    uint64_t size() const{
+        uint64_t size = 0;
+        for (int c = 0; c < SUITS; c++)
+        {
+            size += one_suit(c) + two_suits(c);
+            for (int d = c + 1; d < SUITS; d++)
+            {
+                size += class_left[c] * class_left[d];
+            }
+        }
+        return size;
+    }
+
+    uint64_t index(uint8_t first, uint8_t second) const{
+        card_t suits[2] = {deck_get_suit(first), deck_get_suit(second)};
+        uint32_t ranks[2], classes[2];
+        for (int i = 0; i < 2; i++)
+        {
+            const uint32_t rank = deck_get_rank(i ? second : first);
+            ranks[i] = rank - deck_count_ranks(((1u << rank) - 1) & suit_ranks[suits[i]]);
+            classes[i] = of[suits[i]];
+        }
+        if (classes[0] > classes[1] || (classes[0] == classes[1] && ranks[0] > ranks[1])) {
+            std::swap(ranks[0], ranks[1]);
+            std::swap(classes[0], classes[1]);
+        }
+
+        // The classes before the first card's, then the cases of its class before the hand's.
+        const uint32_t c = classes[0], d = classes[1];
+        uint64_t offset = 0;
+        for (uint32_t e = 0; e < SUITS; e++)
+        {
+            uint64_t later = 0;
+            for (uint32_t f = e + 1; f < SUITS; f++)
+            {
+                later += class_left[f] * (e < c || f < d);
+            }
+            offset += (e < c) * (one_suit(e) + two_suits(e)) + (e <= c) * class_left[e] * later;
+        }
+        if (suits[0] == suits[1]) {
+            return offset + ranks[1] * (ranks[1] - 1) / 2 + ranks[0];
+        }
+        offset += one_suit(c);
+        if (c == d) {
+            return offset + ranks[1] * (ranks[1] + 1) / 2 + ranks[0];
+        }
+        return offset + two_suits(c) + ranks[0] * class_left[d] + ranks[1];
+    }
+
+    bool unindex(uint64_t index, uint8_t hole[2]) const{
+        for (int c = 0; c < SUITS; c++)
+        {
+            if (index < one_suit(c)) {
+                uint32_t high = 1;
+                while ((high + 1) * high / 2 <= index) {
+                    high++;
+                }
+                hole[0] = card(c, 0, index - high * (high - 1) / 2);
+                hole[1] = card(c, 0, high);
+                return true;
+            }
+            index -= one_suit(c);
+            if (index < two_suits(c)) {
+                uint32_t high = 0;
+                while ((high + 2) * (high + 1) / 2 <= index) {
+                    high++;
+                }
+                hole[0] = card(c, 0, index - high * (high + 1) / 2);
+                hole[1] = card(c, 1, high);
+                return true;
+            }
+            index -= two_suits(c);
+            for (int d = c + 1; d < SUITS; d++)
+            {
+                if (index < class_left[c] * class_left[d]) {
+                    hole[0] = card(c, 0, index / class_left[d]);
+                    hole[1] = card(d, 0, index % class_left[d]);
+                    return true;
+                }
+                index -= class_left[c] * class_left[d];
+            }
+        }
+        return false;
+    }
+
+    uint32_t suit_ranks[SUITS];
+    uint32_t of[SUITS];           // class of each suit
+    uint32_t class_suits[SUITS];
+    uint32_t class_left[SUITS];   // ranks the board leaves in each suit of a class
+
+private:
+    // The card holding the nth rank left in the nth suit of a class.
+    uint8_t card(int c, int nth_suit, uint32_t nth_rank) const{
+        int suit = 0;
+        while (of[suit] != static_cast<uint32_t>(c) || nth_suit-- > 0) {
+            suit++;
+        }
+        uint32_t rank = 0;
+        while (suit_ranks[suit] >> rank & 1 || nth_rank-- > 0) {
+            rank++;
+        }
+        return deck_make_card(suit, rank);
     }
 };
 
+// The board major layout of every street: the index of the first hand of each board, in the
+// order of the boards' board first recall indices, followed by the number of hands. Indices
+// fit 32 bits on every street.
+class BoardMajorLayout{
+public:
+    static BoardMajorLayout& get_instance() {
+        static BoardMajorLayout instance;
+        return instance;
+    }
+
+    BoardMajorLayout(const BoardMajorLayout&) = delete;
+    BoardMajorLayout& operator=(const BoardMajorLayout&) = delete;
+    BoardMajorLayout(BoardMajorLayout&&) = delete;
+    BoardMajorLayout& operator=(BoardMajorLayout&&) = delete;
+
+    // The board of an index below the number of hands.
+    uint64_t board(int street, uint64_t index) const{
+        const auto &first = offsets[street];
+        return std::upper_bound(first.begin(), first.end(), index) - first.begin() - 1;
+    }
+
+    uint64_t memory() const{
+        uint64_t bytes = 0;
+        for (const auto &first : offsets)
+        {
+            bytes += first.size() * sizeof(first[0]);
+        }
+        return bytes;
+    }
+
+    std::vector<uint32_t> offsets[4];
+private:
+    BoardMajorLayout() {
+        for (int street = 0; street < 4; street++)
+        {
+            const uint64_t boards = street == 0 ? 1 : hand_indexer_size(&BoardFirstRecall::get_instance().indexers.indexers[street], 0);
+            auto &first = offsets[street];
+            first.resize(boards + 1);
+            uint8_t board[CARDS];
+            uint32_t offset = 0;
+            for (uint64_t b = 0; b < boards; b++)
+            {
+                first[b] = offset;
+                board_first_board(street, b, board);
+                offset += BoardHoles(street, board).size();
+            }
+            first[boards] = offset;
+        }
+    }
+};
+
+static_assert(sizeof(hand_indexer_state_t) <= sizeof(perfect_recall_state),
+              "perfect_recall_state must be able to hold a hand_indexer_state_t");
+static_assert(sizeof(hand_unindex_iterator_t) <= sizeof(canonical_iterator),
+              "canonical_iterator must be able to hold a hand_unindex_iterator_t");
+
 extern "C" {
 
     uint64_t num_imperfect_recall_hands(int street){
@@ -131,8 +900,8 @@ extern "C" {
     }
 
     uint64_t imperfect_recall_index(int street, const uint8_t *cards){
-        const auto &indexers = ImperfectRecall::get_instance().indexers;
-        return hand_index_last(&indexers.indexers[street], cards);
+        const auto &streets = ImperfectRecall::get_instance().streets;
+        return template_kernels().imperfect.index_last(streets, street, cards);
     }
 
     void imperfect_recall_unindex(uint8_t *output, int street, uint64_t index){
@@ -140,14 +909,64 @@ extern "C" {
         hand_unindex(&indexers.indexers[street], indexers.cards_per_street[street].size() - 1, index, output);
     }
 
+    uint64_t imperfect_recall_index_masks(int street, const uint64_t *masks){
+        const auto &streets = ImperfectRecall::get_instance().streets;
+        return template_kernels().imperfect.index_last_masks(streets, street, masks);
+    }
+
+    void imperfect_recall_unindex_masks(uint64_t *masks, int street, uint64_t index){
+        const auto &indexers = ImperfectRecall::get_instance().indexers;
+        hand_unindex_masks(&indexers.indexers[street], indexers.cards_per_street[street].size() - 1, index, masks);
+    }
+
+    void imperfect_recall_index_batch(int street, const uint8_t *cards, size_t n, uint64_t *out){
+        const auto &indexers = ImperfectRecall::get_instance().indexers;
+        hand_index_batch(&indexers.indexers[street], cards, n, out);
+    }
+
+    void imperfect_recall_unindex_batch(int street, const uint64_t *indices, size_t n, uint8_t *out){
+        const auto &indexers = ImperfectRecall::get_instance().indexers;
+        hand_unindex_batch(&indexers.indexers[street], indexers.cards_per_street[street].size() - 1, indices, n, out);
+    }
+
+    void imperfect_recall_canonicalize(int street, const uint8_t *cards, uint8_t *out_cards, uint8_t out_suit_perm[4]){
+        const auto &streets = ImperfectRecall::get_instance().streets;
+        template_kernels().imperfect.canonicalize(streets, street, cards, out_cards, out_suit_perm);
+    }
+
+    void imperfect_recall_canonicalize_batch(int street, const uint8_t *cards, size_t n, uint8_t *out_cards, uint8_t *out_suit_perms){
+        const auto &streets = ImperfectRecall::get_instance().streets;
+        template_kernels().imperfect.canonicalize_batch(streets, street, cards, n, out_cards, out_suit_perms);
+    }
+
+    uint64_t imperfect_recall_expand_count(int street, uint64_t index){
+        const auto &indexers = ImperfectRecall::get_instance().indexers;
+        return hand_expand_count(&indexers.indexers[street], indexers.cards_per_street[street].size() - 1, index);
+    }
+
+    uint64_t imperfect_recall_expand(int street, uint64_t index, expand_callback callback, void *user_data){
+        const auto &indexers = ImperfectRecall::get_instance().indexers;
+        return hand_expand(&indexers.indexers[street], indexers.cards_per_street[street].size() - 1, index, callback, user_data);
+    }
+
+    uint8_t imperfect_recall_multiplicity(int street, uint64_t index){
+        const auto &indexers = ImperfectRecall::get_instance().indexers;
+        return hand_expand_count(&indexers.indexers[street], indexers.cards_per_street[street].size() - 1, index);
+    }
+
+    void imperfect_recall_multiplicities(int street, uint64_t first, size_t n, uint8_t *out){
+        const auto &indexers = ImperfectRecall::get_instance().indexers;
+        hand_multiplicities(&indexers.indexers[street], indexers.cards_per_street[street].size() - 1, first, n, out);
+    }
+
     uint64_t num_perfect_recall_hands(int street){
         const auto &indexers = PerfectRecall::get_instance().indexers;
         return hand_indexer_size(&indexers.indexers[street], indexers.cards_per_street[street].size() - 1);
     }
 
     uint64_t perfect_recall_index(int street, const uint8_t *cards){
-        const auto &indexers = PerfectRecall::get_instance().indexers;
-        return hand_index_last(&indexers.indexers[street], cards);
+        const auto &streets = PerfectRecall::get_instance().streets;
+        return template_kernels().perfect.index_last(streets, street, cards);
     }
 
     void perfect_recall_unindex(uint8_t *output, int street, uint64_t index){
@@ -155,14 +974,100 @@ extern "C" {
         hand_unindex(&indexers.indexers[street], indexers.cards_per_street[street].size() - 1, index, output);
     }
 
+    uint64_t perfect_recall_index_masks(int street, const uint64_t *masks){
+        const auto &streets = PerfectRecall::get_instance().streets;
+        return template_kernels().perfect.index_last_masks(streets, street, masks);
+    }
+
+    void perfect_recall_unindex_masks(uint64_t *masks, int street, uint64_t index){
+        const auto &indexers = PerfectRecall::get_instance().indexers;
+        hand_unindex_masks(&indexers.indexers[street], indexers.cards_per_street[street].size() - 1, index, masks);
+    }
+
+    void perfect_recall_index_batch(int street, const uint8_t *cards, size_t n, uint64_t *out){
+        const auto &indexers = PerfectRecall::get_instance().indexers;
+        hand_index_batch(&indexers.indexers[street], cards, n, out);
+    }
+
+    void perfect_recall_unindex_batch(int street, const uint64_t *indices, size_t n, uint8_t *out){
+        const auto &indexers = PerfectRecall::get_instance().indexers;
+        hand_unindex_batch(&indexers.indexers[street], indexers.cards_per_street[street].size() - 1, indices, n, out);
+    }
+
+    void perfect_recall_canonicalize(int street, const uint8_t *cards, uint8_t *out_cards, uint8_t out_suit_perm[4]){
+        const auto &streets = PerfectRecall::get_instance().streets;
+        template_kernels().perfect.canonicalize(streets, street, cards, out_cards, out_suit_perm);
+    }
+
+    void perfect_recall_canonicalize_batch(int street, const uint8_t *cards, size_t n, uint8_t *out_cards, uint8_t *out_suit_perms){
+        const auto &streets = PerfectRecall::get_instance().streets;
+        template_kernels().perfect.canonicalize_batch(streets, street, cards, n, out_cards, out_suit_perms);
+    }
+
+    uint64_t perfect_recall_expand_count(int street, uint64_t index){
+        const auto &indexers = PerfectRecall::get_instance().indexers;
+        return hand_expand_count(&indexers.indexers[street], indexers.cards_per_street[street].size() - 1, index);
+    }
+
+    uint64_t perfect_recall_expand(int street, uint64_t index, expand_callback callback, void *user_data){
+        const auto &indexers = PerfectRecall::get_instance().indexers;
+        return hand_expand(&indexers.indexers[street], indexers.cards_per_street[street].size() - 1, index, callback, user_data);
+    }
+
+    uint8_t perfect_recall_multiplicity(int street, uint64_t index){
+        const auto &indexers = PerfectRecall::get_instance().indexers;
+        return hand_expand_count(&indexers.indexers[street], indexers.cards_per_street[street].size() - 1, index);
+    }
+
+    void perfect_recall_multiplicities(int street, uint64_t first, size_t n, uint8_t *out){
+        const auto &indexers = PerfectRecall::get_instance().indexers;
+        hand_multiplicities(&indexers.indexers[street], indexers.cards_per_street[street].size() - 1, first, n, out);
+    }
+
+    // The river indexer's earlier rounds enumerate the same configurations in the same
+    // order as the per-street indexers, so its per-round indices are the street indices.
+    void perfect_recall_index_all(const uint8_t *cards, uint64_t out[4]){
+        const auto &streets = PerfectRecall::get_instance().streets;
+        template_kernels().perfect_index_all(streets, cards, out);
+    }
+
+    void perfect_recall_state_init(perfect_recall_state *state){
+        PerfectRecall::get_instance().streets.river.state_init(reinterpret_cast<hand_indexer_state_t*>(state));
+    }
+
+    uint64_t perfect_recall_state_next_street(perfect_recall_state *state, const uint8_t *cards){
+        const auto &streets = PerfectRecall::get_instance().streets;
+        return template_kernels().perfect_next_street(streets, reinterpret_cast<hand_indexer_state_t*>(state), cards);
+    }
+
+    // A street's indexer has the rounds of every earlier street, whose indices are the
+    // earlier streets' indices as for perfect_recall_index_all.
+    uint64_t perfect_recall_project(int street_from, uint64_t index, int street_to){
+        const auto &indexers = PerfectRecall::get_instance().indexers;
+        hand_index_t projected;
+        if (street_to < 0 || !hand_index_project(&indexers.indexers[street_from], street_from, index, street_to, &projected)) {
+            return UINT64_MAX;
+        }
+        return projected;
+    }
+
+    void perfect_recall_project_batch(int street_from, const uint64_t *indices, size_t n, int street_to, uint64_t *out){
+        const auto &indexers = PerfectRecall::get_instance().indexers;
+        if (street_to < 0) {
+            std::fill_n(out, n, UINT64_MAX);
+            return;
+        }
+        hand_index_project_batch(&indexers.indexers[street_from], street_from, indices, n, street_to, out);
+    }
+
     uint64_t num_flop_recall_hands(int street){
         const auto &indexers = FlopRecall::get_instance().indexers;
         return hand_indexer_size(&indexers.indexers[street], indexers.cards_per_street[street].size() - 1);
     }
 
     uint64_t flop_recall_index(int street, const uint8_t *cards){
-        const auto &indexers = FlopRecall::get_instance().indexers;
-        return hand_index_last(&indexers.indexers[street], cards);
+        const auto &streets = FlopRecall::get_instance().streets;
+        return template_kernels().flop.index_last(streets, street, cards);
     }
 
     void flop_recall_unindex(uint8_t *output, int street, uint64_t index){
@@ -170,14 +1075,71 @@ extern "C" {
         hand_unindex(&indexers.indexers[street], indexers.cards_per_street[street].size() - 1, index, output);
     }
 
+    uint64_t flop_recall_index_masks(int street, const uint64_t *masks){
+        const auto &streets = FlopRecall::get_instance().streets;
+        return template_kernels().flop.index_last_masks(streets, street, masks);
+    }
+
+    void flop_recall_unindex_masks(uint64_t *masks, int street, uint64_t index){
+        const auto &indexers = FlopRecall::get_instance().indexers;
+        hand_unindex_masks(&indexers.indexers[street], indexers.cards_per_street[street].size() - 1, index, masks);
+    }
+
+    void flop_recall_index_batch(int street, const uint8_t *cards, size_t n, uint64_t *out){
+        const auto &indexers = FlopRecall::get_instance().indexers;
+        hand_index_batch(&indexers.indexers[street], cards, n, out);
+    }
+
+    void flop_recall_unindex_batch(int street, const uint64_t *indices, size_t n, uint8_t *out){
+        const auto &indexers = FlopRecall::get_instance().indexers;
+        hand_unindex_batch(&indexers.indexers[street], indexers.cards_per_street[street].size() - 1, indices, n, out);
+    }
+
+    void flop_recall_canonicalize(int street, const uint8_t *cards, uint8_t *out_cards, uint8_t out_suit_perm[4]){
+        const auto &streets = FlopRecall::get_instance().streets;
+        template_kernels().flop.canonicalize(streets, street, cards, out_cards, out_suit_perm);
+    }
+
+    void flop_recall_canonicalize_batch(int street, const uint8_t *cards, size_t n, uint8_t *out_cards, uint8_t *out_suit_perms){
+        const auto &streets = FlopRecall::get_instance().streets;
+        template_kernels().flop.canonicalize_batch(streets, street, cards, n, out_cards, out_suit_perms);
+    }
+
+    uint64_t flop_recall_expand_count(int street, uint64_t index){
+        const auto &indexers = FlopRecall::get_instance().indexers;
+        return hand_expand_count(&indexers.indexers[street], indexers.cards_per_street[street].size() - 1, index);
+    }
+
+    uint64_t flop_recall_expand(int street, uint64_t index, expand_callback callback, void *user_data){
+        const auto &indexers = FlopRecall::get_instance().indexers;
+        return hand_expand(&indexers.indexers[street], indexers.cards_per_street[street].size() - 1, index, callback, user_data);
+    }
+
+    uint8_t flop_recall_multiplicity(int street, uint64_t index){
+        const auto &indexers = FlopRecall::get_instance().indexers;
+        return hand_expand_count(&indexers.indexers[street], indexers.cards_per_street[street].size() - 1, index);
+    }
+
+    void flop_recall_multiplicities(int street, uint64_t first, size_t n, uint8_t *out){
+        const auto &indexers = FlopRecall::get_instance().indexers;
+        hand_multiplicities(&indexers.indexers[street], indexers.cards_per_street[street].size() - 1, first, n, out);
+    }
+
+    void index_all_recalls(const uint8_t cards[7], all_indices *out){
+        const auto &imperfect = ImperfectRecall::get_instance().streets;
+        const auto &perfect = PerfectRecall::get_instance().streets;
+        const auto &flop = FlopRecall::get_instance().streets;
+        template_kernels().index_all_recalls(imperfect, perfect, flop, cards, out);
+    }
+
     uint64_t num_board_imperfect_recall_boards(int street){
         const auto &indexers = BoardImperfectRecall::get_instance().indexers;
         return hand_indexer_size(&indexers.indexers[street], indexers.cards_per_street[street].size() - 1);
     }
 
     uint64_t board_imperfect_recall_index(int street, const uint8_t *cards){
-        const auto &indexers = BoardImperfectRecall::get_instance().indexers;
-        return hand_index_last(&indexers.indexers[street], cards);
+        const auto &streets = BoardImperfectRecall::get_instance().streets;
+        return template_kernels().board_imperfect.index_last(streets, street, cards);
     }
 
     void board_imperfect_recall_unindex(uint8_t *output, int street, uint64_t index){
@@ -185,4 +1147,434 @@ extern "C" {
         hand_unindex(&indexers.indexers[street], indexers.cards_per_street[street].size() - 1, index, output);
     }
 
+    uint64_t board_imperfect_recall_index_masks(int street, const uint64_t *masks){
+        const auto &streets = BoardImperfectRecall::get_instance().streets;
+        return template_kernels().board_imperfect.index_last_masks(streets, street, masks);
+    }
+
+    void board_imperfect_recall_unindex_masks(uint64_t *masks, int street, uint64_t index){
+        const auto &indexers = BoardImperfectRecall::get_instance().indexers;
+        hand_unindex_masks(&indexers.indexers[street], indexers.cards_per_street[street].size() - 1, index, masks);
+    }
+
+    void board_imperfect_recall_index_batch(int street, const uint8_t *cards, size_t n, uint64_t *out){
+        const auto &indexers = BoardImperfectRecall::get_instance().indexers;
+        hand_index_batch(&indexers.indexers[street], cards, n, out);
+    }
+
+    void board_imperfect_recall_unindex_batch(int street, const uint64_t *indices, size_t n, uint8_t *out){
+        const auto &indexers = BoardImperfectRecall::get_instance().indexers;
+        hand_unindex_batch(&indexers.indexers[street], indexers.cards_per_street[street].size() - 1, indices, n, out);
+    }
+
+    void board_imperfect_recall_canonicalize(int street, const uint8_t *cards, uint8_t *out_cards, uint8_t out_suit_perm[4]){
+        const auto &streets = BoardImperfectRecall::get_instance().streets;
+        template_kernels().board_imperfect.canonicalize(streets, street, cards, out_cards, out_suit_perm);
+    }
+
+    void board_imperfect_recall_canonicalize_batch(int street, const uint8_t *cards, size_t n, uint8_t *out_cards, uint8_t *out_suit_perms){
+        const auto &streets = BoardImperfectRecall::get_instance().streets;
+        template_kernels().board_imperfect.canonicalize_batch(streets, street, cards, n, out_cards, out_suit_perms);
+    }
+
+    uint64_t board_imperfect_recall_expand_count(int street, uint64_t index){
+        const auto &indexers = BoardImperfectRecall::get_instance().indexers;
+        return hand_expand_count(&indexers.indexers[street], indexers.cards_per_street[street].size() - 1, index);
+    }
+
+    uint64_t board_imperfect_recall_expand(int street, uint64_t index, expand_callback callback, void *user_data){
+        const auto &indexers = BoardImperfectRecall::get_instance().indexers;
+        return hand_expand(&indexers.indexers[street], indexers.cards_per_street[street].size() - 1, index, callback, user_data);
+    }
+
+    uint8_t board_imperfect_recall_multiplicity(int street, uint64_t index){
+        const auto &indexers = BoardImperfectRecall::get_instance().indexers;
+        return hand_expand_count(&indexers.indexers[street], indexers.cards_per_street[street].size() - 1, index);
+    }
+
+    void board_imperfect_recall_multiplicities(int street, uint64_t first, size_t n, uint8_t *out){
+        const auto &indexers = BoardImperfectRecall::get_instance().indexers;
+        hand_multiplicities(&indexers.indexers[street], indexers.cards_per_street[street].size() - 1, first, n, out);
+    }
+
+    uint64_t num_board_first_recall_hands(int street){
+        const auto &indexers = BoardFirstRecall::get_instance().indexers;
+        return hand_indexer_size(&indexers.indexers[street], indexers.cards_per_street[street].size() - 1);
+    }
+
+    uint64_t board_first_recall_index(int street, const uint8_t *cards){
+        const auto &streets = BoardFirstRecall::get_instance().streets;
+        return template_kernels().board_first.index_last(streets, street, cards);
+    }
+
+    void board_first_recall_unindex(uint8_t *output, int street, uint64_t index){
+        const auto &indexers = BoardFirstRecall::get_instance().indexers;
+        hand_unindex(&indexers.indexers[street], indexers.cards_per_street[street].size() - 1, index, output);
+    }
+
+    uint64_t board_first_recall_index_masks(int street, const uint64_t *masks){
+        const auto &streets = BoardFirstRecall::get_instance().streets;
+        return template_kernels().board_first.index_last_masks(streets, street, masks);
+    }
+
+    void board_first_recall_unindex_masks(uint64_t *masks, int street, uint64_t index){
+        const auto &indexers = BoardFirstRecall::get_instance().indexers;
+        hand_unindex_masks(&indexers.indexers[street], indexers.cards_per_street[street].size() - 1, index, masks);
+    }
+
+    void board_first_recall_index_batch(int street, const uint8_t *cards, size_t n, uint64_t *out){
+        const auto &indexers = BoardFirstRecall::get_instance().indexers;
+        hand_index_batch(&indexers.indexers[street], cards, n, out);
+    }
+
+    void board_first_recall_unindex_batch(int street, const uint64_t *indices, size_t n, uint8_t *out){
+        const auto &indexers = BoardFirstRecall::get_instance().indexers;
+        hand_unindex_batch(&indexers.indexers[street], indexers.cards_per_street[street].size() - 1, indices, n, out);
+    }
+
+    void board_first_recall_canonicalize(int street, const uint8_t *cards, uint8_t *out_cards, uint8_t out_suit_perm[4]){
+        const auto &streets = BoardFirstRecall::get_instance().streets;
+        template_kernels().board_first.canonicalize(streets, street, cards, out_cards, out_suit_perm);
+    }
+
+    void board_first_recall_canonicalize_batch(int street, const uint8_t *cards, size_t n, uint8_t *out_cards, uint8_t *out_suit_perms){
+        const auto &streets = BoardFirstRecall::get_instance().streets;
+        template_kernels().board_first.canonicalize_batch(streets, street, cards, n, out_cards, out_suit_perms);
+    }
+
+    uint64_t board_first_recall_expand_count(int street, uint64_t index){
+        const auto &indexers = BoardFirstRecall::get_instance().indexers;
+        return hand_expand_count(&indexers.indexers[street], indexers.cards_per_street[street].size() - 1, index);
+    }
+
+    uint64_t board_first_recall_expand(int street, uint64_t index, expand_callback callback, void *user_data){
+        const auto &indexers = BoardFirstRecall::get_instance().indexers;
+        return hand_expand(&indexers.indexers[street], indexers.cards_per_street[street].size() - 1, index, callback, user_data);
+    }
+
+    uint8_t board_first_recall_multiplicity(int street, uint64_t index){
+        const auto &indexers = BoardFirstRecall::get_instance().indexers;
+        return hand_expand_count(&indexers.indexers[street], indexers.cards_per_street[street].size() - 1, index);
+    }
+
+    void board_first_recall_multiplicities(int street, uint64_t first, size_t n, uint8_t *out){
+        const auto &indexers = BoardFirstRecall::get_instance().indexers;
+        hand_multiplicities(&indexers.indexers[street], indexers.cards_per_street[street].size() - 1, first, n, out);
+    }
+
+    uint64_t num_board_first_recall_boards(int street){
+        return street == 0 ? 1 : hand_indexer_size(&BoardFirstRecall::get_instance().indexers.indexers[street], 0);
+    }
+
+    uint64_t board_first_recall_board_index(int street, const uint8_t *cards){
+        return board_first_board_index(street, cards);
+    }
+
+    uint64_t num_board_first_recall_holes(int street, uint64_t board_index){
+        uint8_t board[CARDS];
+        if (!board_first_board(street, board_index, board)) {
+            return 0;
+        }
+        return BoardHoles(street, board).size();
+    }
+
+    uint64_t board_first_recall_hole_index(int street, const uint8_t *cards){
+        const int board_cards = board_first_board_cards[street];
+        return BoardHoles(street, cards).index(cards[board_cards], cards[board_cards + 1]);
+    }
+
+    bool board_first_recall_unindex_hole(uint8_t *output, int street, uint64_t board_index, uint64_t hole_index){
+        if (!board_first_board(street, board_index, output)) {
+            return false;
+        }
+        return BoardHoles(street, output).unindex(hole_index, &output[board_first_board_cards[street]]);
+    }
+
+    uint64_t num_board_major_hands(int street){
+        return BoardMajorLayout::get_instance().offsets[street].back();
+    }
+
+    uint64_t board_major_index(int street, const uint8_t *cards){
+        const uint64_t board = board_first_board_index(street, cards + 2);
+        return BoardMajorLayout::get_instance().offsets[street][board] + BoardHoles(street, cards + 2).index(cards[0], cards[1]);
+    }
+
+    void board_major_unindex(uint8_t *output, int street, uint64_t index){
+        const BoardMajorLayout &layout = BoardMajorLayout::get_instance();
+        if (index >= layout.offsets[street].back()) {
+            return;
+        }
+        const uint64_t board = layout.board(street, index);
+        board_first_board(street, board, output + 2);
+        BoardHoles(street, output + 2).unindex(index - layout.offsets[street][board], output);
+    }
+
+    uint64_t board_major_board(int street, uint64_t index){
+        const BoardMajorLayout &layout = BoardMajorLayout::get_instance();
+        return index < layout.offsets[street].back() ? layout.board(street, index) : UINT64_MAX;
+    }
+
+    board_major_range board_major_board_range(int street, uint64_t board_index){
+        const auto &first = BoardMajorLayout::get_instance().offsets[street];
+        if (board_index >= first.size() - 1) {
+            return {0, 0};
+        }
+        return {first[board_index], first[board_index + 1] - first[board_index]};
+    }
+
+    void for_each_canonical(hand_recall recall, int street, canonical_hands_callback callback,
+                            void *user_data, int threads){
+        const auto &indexers = recall_indexers(recall);
+        unsigned workers = threads > 0 ? static_cast<unsigned>(threads) : std::max(1u, std::thread::hardware_concurrency());
+        CanonicalSweep(&indexers.indexers[street], indexers.cards_per_street[street].size() - 1, workers).run(callback, user_data);
+    }
+
+    bool canonical_iterator_init(canonical_iterator *iterator, hand_recall recall, int street, uint64_t index){
+        const auto &indexers = recall_indexers(recall);
+        return hand_unindex_iterator_init(&indexers.indexers[street], indexers.cards_per_street[street].size() - 1, index,
+                                          reinterpret_cast<hand_unindex_iterator_t*>(iterator));
+    }
+
+    bool canonical_iterator_next(canonical_iterator *iterator){
+        return hand_unindex_iterator_next(reinterpret_cast<hand_unindex_iterator_t*>(iterator));
+    }
+
+    bool canonical_iterator_advance(canonical_iterator *iterator, uint64_t stride){
+        return hand_unindex_iterator_advance(reinterpret_cast<hand_unindex_iterator_t*>(iterator), stride);
+    }
+
+    uint64_t canonical_iterator_index(const canonical_iterator *iterator){
+        return reinterpret_cast<const hand_unindex_iterator_t*>(iterator)->index;
+    }
+
+    const uint8_t *canonical_iterator_cards(const canonical_iterator *iterator){
+        return reinterpret_cast<const hand_unindex_iterator_t*>(iterator)->cards;
+    }
+
+    const hand_iso_ctx *hand_iso_ctx_create(hand_recall recall){
+        hand_iso_ctx *ctx = new (std::nothrow) hand_iso_ctx{};
+        if (!ctx) {
+            return nullptr;
+        }
+        ctx->recall = recall;
+        switch (recall) {
+            case IMPERFECT_RECALL:   init_ctx<ImperfectRecall>(ctx, &TemplateKernels::imperfect); break;
+            case PERFECT_RECALL:     init_ctx<PerfectRecall>(ctx, &TemplateKernels::perfect); break;
+            case FLOP_RECALL:        init_ctx<FlopRecall>(ctx, &TemplateKernels::flop); break;
+            case BOARD_FIRST_RECALL: init_ctx<BoardFirstRecall>(ctx, &TemplateKernels::board_first); break;
+            default:                 init_ctx<BoardImperfectRecall>(ctx, &TemplateKernels::board_imperfect); break;
+        }
+        return ctx;
+    }
+
+    void hand_iso_ctx_free(const hand_iso_ctx *ctx){
+        delete ctx;
+    }
+
+    void hand_iso_street_unindex(const hand_iso_street *street, uint64_t index, uint8_t *output){
+        hand_unindex(street->indexer, street->round, index, output);
+    }
+
+    void hand_iso_street_index_batch(const hand_iso_street *street, const uint8_t *cards, size_t n, uint64_t *out){
+        hand_index_batch(street->indexer, cards, n, out);
+    }
+
+    void hand_iso_street_unindex_batch(const hand_iso_street *street, const uint64_t *indices, size_t n, uint8_t *out){
+        hand_unindex_batch(street->indexer, street->round, indices, n, out);
+    }
+
+    const hand_iso_successors *hand_iso_successors_build(hand_recall recall, int street, int threads){
+        const SuccessorStreets streets(recall, street);
+        if (!streets.valid()) {
+            return nullptr;
+        }
+        uint32_t *table = new (std::nothrow) uint32_t[streets.size * CARDS];
+        hand_iso_successors *successors = table ? new (std::nothrow) hand_iso_successors{recall, street, streets.size, table, false} : nullptr;
+        if (!successors) {
+            delete[] table;
+            return nullptr;
+        }
+
+        unsigned workers = threads > 0 ? static_cast<unsigned>(threads) : std::max(1u, std::thread::hardware_concurrency());
+        struct Sweep{
+            const SuccessorStreets &streets;
+            uint32_t *table;
+        } sweep{streets, table};
+        CanonicalSweep(streets.indexer, streets.round, workers).run([](int, uint64_t first, size_t n, const uint8_t *cards, void *user_data){
+            const Sweep *job = static_cast<const Sweep*>(user_data);
+            hand_successors(job->streets.indexer, job->streets.next, cards, n, job->table + first * CARDS);
+        }, &sweep);
+        return successors;
+    }
+
+    bool hand_iso_successors_save(const hand_iso_successors *successors, const char *path){
+        const SuccessorStreets streets(successors->recall, successors->street);
+        return hand_successors_save(path, streets.indexer, streets.next, successors->table);
+    }
+
+    const hand_iso_successors *hand_iso_successors_map(hand_recall recall, int street, const char *path, bool verify){
+        const SuccessorStreets streets(recall, street);
+        const uint32_t *table = streets.valid() ? hand_successors_map(path, streets.indexer, streets.next, verify) : nullptr;
+        hand_iso_successors *successors = table ? new (std::nothrow) hand_iso_successors{recall, street, streets.size, table, true} : nullptr;
+        if (table && !successors) {
+            hand_successors_unmap(table);
+        }
+        return successors;
+    }
+
+    void hand_iso_successors_free(const hand_iso_successors *successors){
+        if (successors) {
+            if (successors->mapped) {
+                hand_successors_unmap(successors->table);
+            } else {
+                delete[] successors->table;
+            }
+            delete successors;
+        }
+    }
+
+    // Workers take chunks of a multiple of 64 entries, which start on a 64 bit word of the
+    // table whatever the width, so no two workers write the same word.
+    const hand_iso_projection *hand_iso_projection_build(hand_recall recall, int street, bool packed, int threads){
+        const ProjectionStreets streets(recall, street);
+        if (!streets.valid()) {
+            return nullptr;
+        }
+        const uint32_t bits = packed ? streets.bits() : 32;
+        const size_t bytes = (streets.size * bits + 7) / 8 + 8;
+        uint8_t *table = new (std::nothrow) uint8_t[bytes]();
+        hand_iso_projection *projection = table ? new (std::nothrow) hand_iso_projection{recall, street, streets.size, bits, table, false} : nullptr;
+        if (!projection) {
+            delete[] table;
+            return nullptr;
+        }
+
+        constexpr hand_index_t chunk_size = 64 * CanonicalSweep::block_size;
+        std::atomic<hand_index_t> next_chunk(0);
+        auto work = [&]{
+            const uint32_t hand_size = streets.indexer->round_start[streets.round] + streets.indexer->cards_per_round[streets.round];
+            std::vector<uint8_t> cards(CanonicalSweep::block_size * hand_size);
+            std::vector<hand_index_t> indices(CanonicalSweep::block_size);
+            hand_unindex_iterator_t iterator;
+            for (hand_index_t chunk; (chunk = next_chunk.fetch_add(chunk_size)) < streets.size;)
+            {
+                hand_unindex_iterator_init(streets.indexer, streets.round, chunk, &iterator);
+                for (hand_index_t first = chunk, last = std::min(chunk + chunk_size, streets.size); first < last; first += CanonicalSweep::block_size)
+                {
+                    const size_t n = std::min(CanonicalSweep::block_size, last - first);
+                    for (size_t i = 0; i < n; i++)
+                    {
+                        if (streets.hole_cards_last) {
+                            std::rotate_copy(iterator.cards, iterator.cards + 2, iterator.cards + hand_size, &cards[i * hand_size]);
+                        } else {
+                            std::copy_n(iterator.cards, hand_size, &cards[i * hand_size]);
+                        }
+                        hand_unindex_iterator_next(&iterator);
+                    }
+                    hand_index_batch(streets.target, cards.data(), n, indices.data());
+                    for (size_t i = 0; i < n; i++)
+                    {
+                        const uint64_t bit = (first + i) * bits, shift = bit & 63;
+                        uint8_t *word = table + (bit >> 6) * 8;
+                        uint64_t value;
+                        std::memcpy(&value, word, sizeof(value));
+                        value |= indices[i] << shift;
+                        std::memcpy(word, &value, sizeof(value));
+                        if (shift + bits > 64) {
+                            std::memcpy(&value, word + 8, sizeof(value));
+                            value |= indices[i] >> (64 - shift);
+                            std::memcpy(word + 8, &value, sizeof(value));
+                        }
+                    }
+                }
+            }
+        };
+
+        unsigned workers = threads > 0 ? static_cast<unsigned>(threads) : std::max(1u, std::thread::hardware_concurrency());
+        std::vector<std::thread> others;
+        for (unsigned thread = 1; thread < workers; thread++)
+        {
+            others.emplace_back(work);
+        }
+        work();
+        for (auto &other : others)
+        {
+            other.join();
+        }
+        return projection;
+    }
+
+    bool hand_iso_projection_save(const hand_iso_projection *projection, const char *path){
+        const ProjectionStreets streets(projection->recall, projection->street);
+        return hand_projections_save(path, streets.indexer, streets.target, projection->bits, projection->table);
+    }
+
+    const hand_iso_projection *hand_iso_projection_map(hand_recall recall, int street, const char *path, bool verify){
+        const ProjectionStreets streets(recall, street);
+        uint32_t bits;
+        const void *table = streets.valid() ? hand_projections_map(path, streets.indexer, streets.target, &bits, verify) : nullptr;
+        hand_iso_projection *projection = table ?
+            new (std::nothrow) hand_iso_projection{recall, street, streets.size, bits, static_cast<const uint8_t*>(table), true} : nullptr;
+        if (table && !projection) {
+            hand_projections_unmap(table);
+        }
+        return projection;
+    }
+
+    void hand_iso_projection_free(const hand_iso_projection *projection){
+        if (projection) {
+            if (projection->mapped) {
+                hand_projections_unmap(projection->table);
+            } else {
+                delete[] projection->table;
+            }
+            delete projection;
+        }
+    }
+
+    uint64_t hand_isomorphism_memory_usage(){
+        uint64_t bytes = hand_index_memory();
+        for (const auto *recall : {&ImperfectRecall::get_instance().indexers, &PerfectRecall::get_instance().indexers,
+                                   &FlopRecall::get_instance().indexers, &BoardImperfectRecall::get_instance().indexers,
+                                   &BoardFirstRecall::get_instance().indexers})
+        {
+            for (const auto &indexer : recall->indexers)
+            {
+                bytes += hand_indexer_memory(&indexer);
+            }
+        }
+        return bytes + BoardMajorLayout::get_instance().memory();
+    }
+
+    bool hand_isomorphism_save_tables(const char *path){
+        std::vector<const hand_indexer_t*> indexers;
+        for (const auto *recall : {&ImperfectRecall::get_instance().indexers, &PerfectRecall::get_instance().indexers,
+                                   &FlopRecall::get_instance().indexers, &BoardImperfectRecall::get_instance().indexers,
+                                   &BoardFirstRecall::get_instance().indexers})
+        {
+            for (const auto &indexer : recall->indexers)
+            {
+                indexers.push_back(&indexer);
+            }
+        }
+        return hand_index_save(path, indexers.size(), indexers.data());
+    }
+
+    bool hand_isomorphism_map_tables(const char *path, bool verify){
+        return MappedIndexers::get_instance().map(path, verify);
+    }
+
+    const char *hand_isomorphism_kernels(){
+        return template_kernels().name;
+    }
+
+    bool hand_isomorphism_use_kernels(const char *name){
+        const TemplateKernels *kernels = find_template_kernels(name);
+        if (!kernels || !hand_index_use_kernels(name)) {
+            return false;
+        }
+        selected_template_kernels.store(kernels, std::memory_order_release);
+        return true;
+    }
+
 }
\ No newline at end of file
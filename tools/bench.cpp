@@ -0,0 +1,882 @@
+/**
+ * bench.cpp
+ *
+ * Measures the throughput and latency of indexing, unindexing, iterating and incremental
+ * indexing for every recall type and street through the public API, under random, sorted
+ * and cache hostile access orders. Also reports how long each recall type takes to
+ * initialize and how much memory the lookup tables use, and compares sweeps over the
+ * hands of one board after another in imperfect recall and board major tables.
+ *
+ * Each measurement is repeated and the fastest run is kept. Chained operations feed
+ * each result into the address of the next call, so they measure latency rather than
+ * throughput. With --perf, the cycles, cache misses and branch misses of the kept run
+ * are read with perf_event_open (Linux only). With --csv, every metric is printed on
+ * its own line as recall,street,op,pattern,metric,value so runs can be diffed.
+ *
+ * Usage: hand_isomorphism_bench [options]
+ *   --hands N      hands or indices per measurement (default 1048576)
+ *   --repeat N     runs per measurement (default 5)
+ *   --recall R     imperfect, perfect, flop, board, board_first or all (default all)
+ *   --pattern P    random, sorted, hostile or all (default all)
+ *   --tables PATH  map a file written by hand_isomorphism_save_tables before initializing
+ *   --seed N       seed of the random deals (default 1)
+ *   --kernels K    instruction set flavour of the kernels, as hand_isomorphism_use_kernels
+ *   --perf         read hardware counters
+ *   --csv          print machine readable output
+ */
+
+#include "hand_isomorphism.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <numeric>
+#include <random>
+#include <string>
+#include <vector>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr int STREETS = 4;
+constexpr int DEAL_CARDS = 7;
+
+// Offset and length in a deal of the cards dealt on each street.
+constexpr int street_start[STREETS] = {0, 2, 5, 6};
+constexpr int street_cards[STREETS] = {2, 3, 1, 1};
+
+struct Recall{
+    const char *name;
+    hand_recall type;
+    uint64_t (*size)(int street);
+    uint64_t (*index)(int street, const uint8_t *cards);
+    void (*unindex)(uint8_t *output, int street, uint64_t index);
+    void (*index_batch)(int street, const uint8_t *cards, size_t n, uint64_t *out);
+    void (*unindex_batch)(int street, const uint64_t *indices, size_t n, uint8_t *out);
+    void (*canonicalize)(int street, const uint8_t *cards, uint8_t *out_cards, uint8_t out_suit_perm[4]);
+    void (*multiplicities)(int street, uint64_t first, size_t n, uint8_t *out);
+    int first_card;  // cards of the deal before the ones this recall type indexes
+    int cards[STREETS];
+};
+
+const Recall recalls[] = {
+    {"imperfect", IMPERFECT_RECALL, num_imperfect_recall_hands, imperfect_recall_index, imperfect_recall_unindex,
+     imperfect_recall_index_batch, imperfect_recall_unindex_batch, imperfect_recall_canonicalize, imperfect_recall_multiplicities, 0, {2, 5, 6, 7}},
+    {"perfect", PERFECT_RECALL, num_perfect_recall_hands, perfect_recall_index, perfect_recall_unindex,
+     perfect_recall_index_batch, perfect_recall_unindex_batch, perfect_recall_canonicalize, perfect_recall_multiplicities, 0, {2, 5, 6, 7}},
+    {"flop", FLOP_RECALL, num_flop_recall_hands, flop_recall_index, flop_recall_unindex,
+     flop_recall_index_batch, flop_recall_unindex_batch, flop_recall_canonicalize, flop_recall_multiplicities, 0, {2, 5, 6, 7}},
+    {"board", BOARD_IMPERFECT_RECALL, num_board_imperfect_recall_boards, board_imperfect_recall_index, board_imperfect_recall_unindex,
+     board_imperfect_recall_index_batch, board_imperfect_recall_unindex_batch, board_imperfect_recall_canonicalize, board_imperfect_recall_multiplicities, 2, {1, 3, 4, 5}},
+    {"board_first", BOARD_FIRST_RECALL, num_board_first_recall_hands, board_first_recall_index, board_first_recall_unindex,
+     board_first_recall_index_batch, board_first_recall_unindex_batch, board_first_recall_canonicalize, board_first_recall_multiplicities, 0, {2, 5, 6, 7}},
+};
+
+const char *const patterns[] = {"random", "sorted", "hostile"};
+
+// Calls f with the compile time indexer of a street of a context.
+template <hand_recall Type, class F>
+uint64_t with_street_indexer(const hand_iso_ctx *ctx, int street, F&& f){
+    switch (street) {
+        case 0:  return f(hand_iso::street_indexer<Type, 0>(ctx));
+        case 1:  return f(hand_iso::street_indexer<Type, 1>(ctx));
+        case 2:  return f(hand_iso::street_indexer<Type, 2>(ctx));
+        default: return f(hand_iso::street_indexer<Type, 3>(ctx));
+    }
+}
+
+template <class F>
+uint64_t with_street_indexer(const hand_iso_ctx *ctx, int street, F&& f){
+    switch (ctx->recall) {
+        case IMPERFECT_RECALL:   return with_street_indexer<IMPERFECT_RECALL>(ctx, street, f);
+        case PERFECT_RECALL:     return with_street_indexer<PERFECT_RECALL>(ctx, street, f);
+        case FLOP_RECALL:        return with_street_indexer<FLOP_RECALL>(ctx, street, f);
+        case BOARD_FIRST_RECALL: return with_street_indexer<BOARD_FIRST_RECALL>(ctx, street, f);
+        default:                 return with_street_indexer<BOARD_IMPERFECT_RECALL>(ctx, street, f);
+    }
+}
+
+struct Options{
+    size_t hands = size_t(1) << 20;
+    int repeat = 5;
+    std::string recall = "all";
+    std::string pattern = "all";
+    const char *tables = nullptr;
+    uint64_t seed = 1;
+    const char *kernels = nullptr;
+    bool perf = false;
+    bool csv = false;
+};
+
+// Keeps the compiler from discarding the benchmarked calls.
+volatile uint64_t sink;
+
+class PerfCounters{
+public:
+    static constexpr int events = 3;
+    static constexpr const char *names[events] = {"cycles", "cache_misses", "branch_misses"};
+
+    PerfCounters() = default;
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    ~PerfCounters(){
+#ifdef __linux__
+        for (int fd : fds)
+        {
+            if (fd >= 0) {
+                close(fd);
+            }
+        }
+#endif
+    }
+
+    bool open(){
+#ifdef __linux__
+        static const uint64_t configs[events] = {
+            PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES};
+        for (int i = 0; i < events; i++)
+        {
+            perf_event_attr attr;
+            std::memset(&attr, 0, sizeof(attr));
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.size = sizeof(attr);
+            attr.config = configs[i];
+            attr.disabled = 1;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            fds[i] = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+            if (fds[i] < 0) {
+                return false;
+            }
+        }
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    bool is_open() const{
+        return fds[0] >= 0;
+    }
+
+    void start(){
+#ifdef __linux__
+        for (int fd : fds)
+        {
+            if (fd >= 0) {
+                ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+                ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+            }
+        }
+#endif
+    }
+
+    void stop(uint64_t counts[events]){
+        for (int i = 0; i < events; i++)
+        {
+            counts[i] = 0;
+#ifdef __linux__
+            if (fds[i] >= 0) {
+                ioctl(fds[i], PERF_EVENT_IOC_DISABLE, 0);
+                if (read(fds[i], &counts[i], sizeof(counts[i])) != sizeof(counts[i])) {
+                    counts[i] = 0;
+                }
+            }
+#endif
+        }
+    }
+
+private:
+    int fds[events] = {-1, -1, -1};
+};
+
+class Report{
+public:
+    explicit Report(const Options& options):
+        csv(options.csv){
+        if (csv) {
+            std::printf("recall,street,op,pattern,metric,value\n");
+        }
+    }
+
+    void value(const char *recall, const char *metric, double value, const char *unit){
+        if (csv) {
+            std::printf("%s,,,,%s,%.6g\n", recall, metric, value);
+        } else {
+            std::printf("%-11s %-14s %14.3f %s\n", recall, metric, value, unit);
+        }
+    }
+
+    void text(const char *recall, const char *metric, const char *value){
+        if (csv) {
+            std::printf("%s,,,,%s,%s\n", recall, metric, value);
+        } else {
+            std::printf("%-11s %-14s %14s\n", recall, metric, value);
+        }
+    }
+
+    void heading(bool perf){
+        if (!csv) {
+            std::printf("\n%-11s %-6s %-18s %-8s %12s %14s", "recall", "street", "op", "pattern", "ns/op", "ops/s");
+            if (perf) {
+                std::printf(" %12s %12s %12s", "cycles/op", "misses/op", "br-miss/op");
+            }
+            std::printf("\n");
+        }
+    }
+
+    void measurement(const char *recall, const std::string& street, const char *op, const char *pattern,
+                     double ns_per_op, const double *counters_per_op){
+        double ops_per_sec = ns_per_op > 0 ? 1e9 / ns_per_op : 0;
+        if (csv) {
+            const char *prefix_format = "%s,%s,%s,%s,";
+            std::printf(prefix_format, recall, street.c_str(), op, pattern);
+            std::printf("ns_per_op,%.6g\n", ns_per_op);
+            std::printf(prefix_format, recall, street.c_str(), op, pattern);
+            std::printf("ops_per_sec,%.6g\n", ops_per_sec);
+            for (int i = 0; counters_per_op && i < PerfCounters::events; i++)
+            {
+                std::printf(prefix_format, recall, street.c_str(), op, pattern);
+                std::printf("%s_per_op,%.6g\n", PerfCounters::names[i], counters_per_op[i]);
+            }
+        } else {
+            std::printf("%-11s %-6s %-18s %-8s %12.2f %14.0f", recall, street.c_str(), op, pattern, ns_per_op, ops_per_sec);
+            for (int i = 0; counters_per_op && i < PerfCounters::events; i++)
+            {
+                std::printf(" %12.2f", counters_per_op[i]);
+            }
+            std::printf("\n");
+        }
+        std::fflush(stdout);
+    }
+
+private:
+    const bool csv;
+};
+
+class Bench{
+public:
+    Bench(const Options& options, Report& report):
+        options(options), report(report){
+        if (options.perf && !counters.open()) {
+            std::fprintf(stderr, "perf_event_open is not available; hardware counters are not reported\n");
+        }
+        deal_hands();
+    }
+
+    void run_recall(const Recall& recall){
+        report.heading(counters.is_open());
+        for (int street = 0; street < STREETS; street++)
+        {
+            for (const char *pattern : patterns)
+            {
+                if (selected(pattern)) {
+                    run_street(recall, street, pattern);
+                }
+            }
+        }
+        if (std::strcmp(recall.name, "perfect") == 0) {
+            run_incremental();
+            run_projection();
+        }
+        if (recall.type == BOARD_FIRST_RECALL) {
+            run_board_first(recall);
+        }
+        if (recall.type == IMPERFECT_RECALL) {
+            run_board_major();
+        }
+    }
+
+    void run_all_streets(){
+        report.heading(counters.is_open());
+        std::vector<uint64_t> river(options.hands);
+        perfect_recall_index_batch(STREETS - 1, deals.data(), options.hands, river.data());
+        for (const char *pattern : patterns)
+        {
+            if (!selected(pattern)) {
+                continue;
+            }
+            std::vector<uint8_t> hands = arrange(deals, DEAL_CARDS, river, pattern);
+            measure("perfect", "all", "index_all", pattern, [&]{
+                uint64_t sum = 0, out[STREETS];
+                for (size_t i = 0; i < options.hands; i++)
+                {
+                    perfect_recall_index_all(&hands[i * DEAL_CARDS], out);
+                    sum += out[STREETS - 1];
+                }
+                return sum;
+            });
+            measure("all", "all", "index_all_recalls", pattern, [&]{
+                uint64_t sum = 0;
+                all_indices out;
+                for (size_t i = 0; i < options.hands; i++)
+                {
+                    index_all_recalls(&hands[i * DEAL_CARDS], &out);
+                    sum += out.imperfect_recall[STREETS - 1] + out.flop_recall[STREETS - 1];
+                }
+                return sum;
+            });
+        }
+    }
+
+private:
+    bool selected(const char *pattern) const{
+        return options.pattern == "all" || options.pattern == pattern;
+    }
+
+    void deal_hands(){
+        std::mt19937_64 rng(options.seed);
+        deals.resize(options.hands * DEAL_CARDS);
+        uint8_t deck[52];
+        for (size_t i = 0; i < options.hands; i++)
+        {
+            std::iota(deck, deck + 52, uint8_t(0));
+            for (int j = 0; j < DEAL_CARDS; j++)
+            {
+                std::swap(deck[j], deck[j + rng() % (52 - j)]);
+            }
+            std::copy(deck, deck + DEAL_CARDS, &deals[i * DEAL_CARDS]);
+        }
+    }
+
+    // Order of the elements for a pattern: as generated, by key, or by key with
+    // consecutive elements spread as far apart as bit reversal of the position takes them.
+    std::vector<size_t> order(const std::vector<uint64_t>& keys, const char *pattern) const{
+        std::vector<size_t> order(keys.size());
+        std::iota(order.begin(), order.end(), size_t(0));
+        if (std::strcmp(pattern, "random") == 0) {
+            return order;
+        }
+        std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b){ return keys[a] < keys[b]; });
+        if (std::strcmp(pattern, "sorted") == 0) {
+            return order;
+        }
+
+        uint32_t bits = 0;
+        while ((size_t(1) << bits) < order.size()) {
+            bits++;
+        }
+        std::vector<size_t> hostile;
+        hostile.reserve(order.size());
+        for (size_t i = 0; i < (size_t(1) << bits); i++)
+        {
+            size_t reversed = 0;
+            for (uint32_t b = 0; b < bits; b++)
+            {
+                reversed |= (i >> b & 1) << (bits - 1 - b);
+            }
+            if (reversed < order.size()) {
+                hostile.push_back(order[reversed]);
+            }
+        }
+        return hostile;
+    }
+
+    std::vector<uint8_t> arrange(const std::vector<uint8_t>& source, size_t stride,
+                                 const std::vector<uint64_t>& keys, const char *pattern) const{
+        std::vector<uint8_t> arranged(source.size());
+        std::vector<size_t> positions = order(keys, pattern);
+        for (size_t i = 0; i < positions.size(); i++)
+        {
+            std::copy_n(&source[positions[i] * stride], stride, &arranged[i * stride]);
+        }
+        return arranged;
+    }
+
+    // Runs a benchmark options.repeat times and reports its fastest run. The benchmark
+    // performs options.hands operations and returns a value derived from their results.
+    template <class F>
+    void measure(const char *recall, const std::string& street, const char *op, const char *pattern, F&& benchmark){
+        double best = -1;
+        uint64_t best_counts[PerfCounters::events] = {};
+        for (int r = 0; r < options.repeat; r++)
+        {
+            uint64_t counts[PerfCounters::events];
+            counters.start();
+            Clock::time_point start = Clock::now();
+            sink = sink + benchmark();
+            double elapsed = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+            counters.stop(counts);
+            if (best < 0 || elapsed < best) {
+                best = elapsed;
+                std::copy(counts, counts + PerfCounters::events, best_counts);
+            }
+        }
+
+        double per_op[PerfCounters::events];
+        for (int i = 0; i < PerfCounters::events; i++)
+        {
+            per_op[i] = double(best_counts[i]) / options.hands;
+        }
+        report.measurement(recall, street, op, pattern, best / options.hands, counters.is_open() ? per_op : nullptr);
+    }
+
+    void run_street(const Recall& recall, int street, const char *pattern){
+        const size_t n = options.hands, cards = recall.cards[street];
+        const std::string name = std::to_string(street);
+
+        std::vector<uint8_t> hands(n * cards);
+        for (size_t i = 0; i < n; i++)
+        {
+            std::copy_n(&deals[i * DEAL_CARDS + recall.first_card], cards, &hands[i * cards]);
+        }
+        std::vector<uint64_t> indices(n);
+        recall.index_batch(street, hands.data(), n, indices.data());
+        hands = arrange(hands, cards, indices, pattern);
+
+        measure(recall.name, name, "index", pattern, [&]{
+            uint64_t sum = 0;
+            for (size_t i = 0; i < n; i++)
+            {
+                sum += recall.index(street, &hands[i * cards]);
+            }
+            return sum;
+        });
+        // Indices are far below 2^63, so the shifted index is always 0, but the next hand's
+        // address depends on it and the calls cannot overlap.
+        measure(recall.name, name, "index_chain", pattern, [&]{
+            uint64_t index = 0;
+            for (size_t i = 0; i < n; i++)
+            {
+                index = recall.index(street, &hands[i * cards + (index >> 63)]);
+            }
+            return index;
+        });
+        // Through a context's street handle, and through its compile time indexer inlined here.
+        const hand_iso_ctx *ctx = hand_iso_ctx_create(recall.type);
+        const hand_iso_street *handle = hand_iso_ctx_street(ctx, street);
+        measure(recall.name, name, "index_ctx", pattern, [&]{
+            uint64_t sum = 0;
+            for (size_t i = 0; i < n; i++)
+            {
+                sum += hand_iso_street_index(handle, &hands[i * cards]);
+            }
+            return sum;
+        });
+        measure(recall.name, name, "index_inline", pattern, [&]{
+            return with_street_indexer(ctx, street, [&](const auto& indexer){
+                uint64_t sum = 0;
+                for (size_t i = 0; i < n; i++)
+                {
+                    sum += indexer.index_last(&hands[i * cards]);
+                }
+                return sum;
+            });
+        });
+        hand_iso_ctx_free(ctx);
+        std::vector<uint64_t> out(n);
+        measure(recall.name, name, "index_batch", pattern, [&]{
+            recall.index_batch(street, hands.data(), n, out.data());
+            return out[n - 1];
+        });
+        measure(recall.name, name, "canonicalize", pattern, [&]{
+            uint8_t canonical[DEAL_CARDS], suits[4];
+            uint64_t sum = 0;
+            for (size_t i = 0; i < n; i++)
+            {
+                recall.canonicalize(street, &hands[i * cards], canonical, suits);
+                sum += canonical[0] + suits[0];
+            }
+            return sum;
+        });
+
+        const uint64_t size = recall.size(street);
+        std::mt19937_64 rng(options.seed + street);
+        for (auto &index : indices)
+        {
+            index = rng() % size;
+        }
+        std::vector<size_t> positions = order(indices, pattern);
+        std::vector<uint64_t> arranged(n);
+        for (size_t i = 0; i < n; i++)
+        {
+            arranged[i] = indices[positions[i]];
+        }
+
+        std::vector<uint8_t> canonical(n * cards);
+        measure(recall.name, name, "unindex", pattern, [&]{
+            uint64_t sum = 0;
+            for (size_t i = 0; i < n; i++)
+            {
+                recall.unindex(&canonical[0], street, arranged[i]);
+                sum += canonical[0];
+            }
+            return sum;
+        });
+        // Cards are below 2^7, so the shifted card is always 0.
+        measure(recall.name, name, "unindex_chain", pattern, [&]{
+            uint8_t card = 0;
+            for (size_t i = 0; i < n; i++)
+            {
+                recall.unindex(&canonical[0], street, arranged[i + (card >> 7)]);
+                card = canonical[cards - 1];
+            }
+            return uint64_t(card);
+        });
+        measure(recall.name, name, "unindex_batch", pattern, [&]{
+            recall.unindex_batch(street, arranged.data(), n, canonical.data());
+            return uint64_t(canonical[n * cards - 1]);
+        });
+        // Walking indices in order has nothing to arrange, so it is only measured once.
+        if (std::strcmp(pattern, "sorted") == 0) {
+            measure(recall.name, name, "iterate", pattern, [&]{
+                canonical_iterator iterator;
+                canonical_iterator_init(&iterator, recall.type, street, 0);
+                uint64_t sum = 0;
+                for (size_t i = 0; i < n; i++)
+                {
+                    sum += canonical_iterator_cards(&iterator)[cards - 1];
+                    if (!canonical_iterator_next(&iterator)) {
+                        canonical_iterator_init(&iterator, recall.type, street, 0);
+                    }
+                }
+                return sum;
+            });
+            // n consecutive indices, starting over from the first at the end of the street.
+            std::vector<uint8_t> multiplicities(n);
+            measure(recall.name, name, "multiplicities", pattern, [&]{
+                for (size_t i = 0; i < n;)
+                {
+                    const size_t first = std::min<uint64_t>(arranged[0], size - 1) + i;
+                    const size_t count = std::min<uint64_t>(n - i, size - first % size);
+                    recall.multiplicities(street, first % size, count, &multiplicities[i]);
+                    i += count;
+                }
+                return uint64_t(multiplicities[n - 1]);
+            });
+        }
+    }
+
+    // Cost of the earlier street indices of river indices, projected from the index and
+    // through its canonical hand.
+    void run_projection(){
+        const size_t n = options.hands;
+        const uint64_t size = num_perfect_recall_hands(3);
+        std::vector<uint64_t> river(n), out(n);
+        for (int street = 0; street < STREETS - 1; street++)
+        {
+            for (const char *pattern : patterns)
+            {
+                if (!selected(pattern)) {
+                    continue;
+                }
+                std::mt19937_64 rng(options.seed + street);
+                for (auto &index : river)
+                {
+                    index = rng() % size;
+                }
+                std::vector<size_t> positions = order(river, pattern);
+                std::vector<uint64_t> arranged(n);
+                for (size_t i = 0; i < n; i++)
+                {
+                    arranged[i] = river[positions[i]];
+                }
+
+                const std::string name = "3>" + std::to_string(street);
+                measure("perfect", name, "project", pattern, [&]{
+                    uint64_t sum = 0;
+                    for (size_t i = 0; i < n; i++)
+                    {
+                        sum += perfect_recall_project(3, arranged[i], street);
+                    }
+                    return sum;
+                });
+                measure("perfect", name, "project_batch", pattern, [&]{
+                    perfect_recall_project_batch(3, arranged.data(), n, street, out.data());
+                    return out[n - 1];
+                });
+                measure("perfect", name, "unindex_index", pattern, [&]{
+                    uint8_t cards[DEAL_CARDS];
+                    uint64_t sum = 0;
+                    for (size_t i = 0; i < n; i++)
+                    {
+                        perfect_recall_unindex(cards, 3, arranged[i]);
+                        sum += perfect_recall_index(street, cards);
+                    }
+                    return sum;
+                });
+            }
+        }
+    }
+
+    // Board first recall hands split into the board index and the hole index given the board,
+    // against the full index measured by run_street.
+    void run_board_first(const Recall& recall){
+        const size_t n = options.hands;
+        for (int street = 1; street < STREETS; street++)
+        {
+            const size_t cards = recall.cards[street];
+            for (const char *pattern : patterns)
+            {
+                if (!selected(pattern)) {
+                    continue;
+                }
+                std::vector<uint8_t> hands(n * cards);
+                for (size_t i = 0; i < n; i++)
+                {
+                    std::copy_n(&deals[i * DEAL_CARDS], cards, &hands[i * cards]);
+                }
+                std::vector<uint64_t> indices(n);
+                recall.index_batch(street, hands.data(), n, indices.data());
+                hands = arrange(hands, cards, indices, pattern);
+
+                std::vector<uint64_t> boards(n), holes(n);
+                for (size_t i = 0; i < n; i++)
+                {
+                    boards[i] = board_first_recall_board_index(street, &hands[i * cards]);
+                    holes[i] = board_first_recall_hole_index(street, &hands[i * cards]);
+                }
+
+                const std::string name = std::to_string(street);
+                measure(recall.name, name, "board_index", pattern, [&]{
+                    uint64_t sum = 0;
+                    for (size_t i = 0; i < n; i++)
+                    {
+                        sum += board_first_recall_board_index(street, &hands[i * cards]);
+                    }
+                    return sum;
+                });
+                measure(recall.name, name, "hole_index", pattern, [&]{
+                    uint64_t sum = 0;
+                    for (size_t i = 0; i < n; i++)
+                    {
+                        sum += board_first_recall_hole_index(street, &hands[i * cards]);
+                    }
+                    return sum;
+                });
+                measure(recall.name, name, "unindex_hole", pattern, [&]{
+                    uint8_t hand[DEAL_CARDS];
+                    uint64_t sum = 0;
+                    for (size_t i = 0; i < n; i++)
+                    {
+                        board_first_recall_unindex_hole(hand, street, boards[i], holes[i]);
+                        sum += hand[cards - 1];
+                    }
+                    return sum;
+                });
+            }
+        }
+    }
+
+    // Imperfect recall hands in the board major layout. A sweep visits every hand of one
+    // board after another, as a solver iterating the hands of each board does, and adds to
+    // the entry of each hand in a table with one entry per index: under imperfect recall the
+    // hands of a board are spread over the whole table, under board major they are adjacent.
+    void run_board_major(){
+        const size_t n = options.hands;
+        for (int street = 1; street < STREETS; street++)
+        {
+            const size_t cards = street_start[street] + street_cards[street];
+            const std::string name = std::to_string(street);
+
+            std::vector<uint8_t> hands(n * cards);
+            for (size_t i = 0; i < n; i++)
+            {
+                std::copy_n(&deals[i * DEAL_CARDS], cards, &hands[i * cards]);
+            }
+            if (selected("random")) {
+                measure("board_major", name, "index", "random", [&]{
+                    uint64_t sum = 0;
+                    for (size_t i = 0; i < n; i++)
+                    {
+                        sum += board_major_index(street, &hands[i * cards]);
+                    }
+                    return sum;
+                });
+            }
+
+            const uint64_t size = num_board_major_hands(street), boards = num_board_imperfect_recall_boards(street);
+            std::mt19937_64 rng(options.seed + street);
+            std::vector<uint64_t> board_major, imperfect;
+            board_major.reserve(n);
+            imperfect.reserve(n);
+            while (board_major.size() < n) {
+                const board_major_range range = board_major_board_range(street, rng() % boards);
+                for (uint64_t index = range.first; index < range.first + range.size && board_major.size() < n; index++)
+                {
+                    uint8_t hand[DEAL_CARDS];
+                    board_major_unindex(hand, street, index);
+                    board_major.push_back(index);
+                    imperfect.push_back(imperfect_recall_index(street, hand));
+                }
+            }
+
+            measure("board_major", name, "unindex", "boards", [&]{
+                uint8_t hand[DEAL_CARDS];
+                uint64_t sum = 0;
+                for (size_t i = 0; i < n; i++)
+                {
+                    board_major_unindex(hand, street, board_major[i]);
+                    sum += hand[0];
+                }
+                return sum;
+            });
+            std::vector<float> table(size);
+            for (const auto *indices : {&imperfect, &board_major})
+            {
+                measure(indices == &imperfect ? "imperfect" : "board_major", name, "board_sweep", "boards", [&]{
+                    for (size_t i = 0; i < n; i++)
+                    {
+                        table[(*indices)[i]] += 1;
+                    }
+                    return uint64_t(table[(*indices)[n - 1]]);
+                });
+            }
+        }
+    }
+
+    // Cost of extending a perfect recall state by one street, from states that hold the
+    // earlier streets already.
+    void run_incremental(){
+        const size_t n = options.hands;
+        std::vector<perfect_recall_state> states(n);
+        for (auto &state : states)
+        {
+            perfect_recall_state_init(&state);
+        }
+        for (int street = 0; street < STREETS; street++)
+        {
+            for (const char *pattern : patterns)
+            {
+                if (!selected(pattern)) {
+                    continue;
+                }
+                std::vector<uint8_t> hands(n * street_cards[street]);
+                std::vector<perfect_recall_state> arranged(n);
+                std::vector<uint64_t> keys(n);
+                for (size_t i = 0; i < n; i++)
+                {
+                    perfect_recall_state state = states[i];
+                    keys[i] = perfect_recall_state_next_street(&state, &deals[i * DEAL_CARDS + street_start[street]]);
+                }
+                std::vector<size_t> positions = order(keys, pattern);
+                for (size_t i = 0; i < n; i++)
+                {
+                    std::copy_n(&deals[positions[i] * DEAL_CARDS + street_start[street]], street_cards[street],
+                                &hands[i * street_cards[street]]);
+                    arranged[i] = states[positions[i]];
+                }
+
+                measure("perfect", std::to_string(street), "next_street", pattern, [&]{
+                    uint64_t sum = 0;
+                    for (size_t i = 0; i < n; i++)
+                    {
+                        perfect_recall_state state = arranged[i];
+                        sum += perfect_recall_state_next_street(&state, &hands[i * street_cards[street]]);
+                    }
+                    return sum;
+                });
+            }
+            for (size_t i = 0; i < n; i++)
+            {
+                perfect_recall_state_next_street(&states[i], &deals[i * DEAL_CARDS + street_start[street]]);
+            }
+        }
+    }
+
+    const Options& options;
+    Report& report;
+    PerfCounters counters;
+    std::vector<uint8_t> deals;
+};
+
+bool parse_options(int argc, char **argv, Options *options){
+    for (int i = 1; i < argc; i++)
+    {
+        const std::string arg = argv[i];
+        const char *value = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (arg == "--perf") {
+            options->perf = true;
+        } else if (arg == "--csv") {
+            options->csv = true;
+        } else if (!value) {
+            return false;
+        } else if (arg == "--hands") {
+            options->hands = std::strtoull(value, nullptr, 10);
+            i++;
+        } else if (arg == "--repeat") {
+            options->repeat = std::atoi(value);
+            i++;
+        } else if (arg == "--recall") {
+            options->recall = value;
+            i++;
+        } else if (arg == "--pattern") {
+            options->pattern = value;
+            i++;
+        } else if (arg == "--tables") {
+            options->tables = value;
+            i++;
+        } else if (arg == "--seed") {
+            options->seed = std::strtoull(value, nullptr, 10);
+            i++;
+        } else if (arg == "--kernels") {
+            options->kernels = value;
+            i++;
+        } else {
+            return false;
+        }
+    }
+    return options->hands > 0 && options->repeat > 0;
+}
+
+}  // namespace
+
+int main(int argc, char **argv){
+    Options options;
+    if (!parse_options(argc, argv, &options)) {
+        std::fprintf(stderr,
+                     "usage: %s [--hands N] [--repeat N] [--recall imperfect|perfect|flop|board|board_first|all]\n"
+                     "       [--pattern random|sorted|hostile|all] [--tables PATH] [--seed N]\n"
+                     "       [--kernels avx512|avx2|popcnt|generic] [--perf] [--csv]\n",
+                     argv[0]);
+        return 1;
+    }
+
+    if (options.kernels && !hand_isomorphism_use_kernels(options.kernels)) {
+        std::fprintf(stderr, "%s: kernels %s are not available on this cpu\n", argv[0], options.kernels);
+        return 1;
+    }
+
+    Report report(options);
+    report.text("all", "kernels", hand_isomorphism_kernels());
+    if (options.tables) {
+        Clock::time_point start = Clock::now();
+        if (!hand_isomorphism_map_tables(options.tables, false)) {
+            std::fprintf(stderr, "%s: could not map %s\n", argv[0], options.tables);
+            return 1;
+        }
+        report.value("tables", "map_ms", std::chrono::duration<double, std::milli>(Clock::now() - start).count(), "ms");
+    }
+
+    // The first recall type used also computes the global lookup tables.
+    for (const Recall &recall : recalls)
+    {
+        Clock::time_point start = Clock::now();
+        sink = sink + recall.size(0);
+        report.value(recall.name, "init_ms", std::chrono::duration<double, std::milli>(Clock::now() - start).count(), "ms");
+    }
+    report.value("all", "table_bytes", double(hand_isomorphism_memory_usage()), "bytes");
+
+    Bench bench(options, report);
+    for (const Recall &recall : recalls)
+    {
+        if (options.recall == "all" || options.recall == recall.name) {
+            bench.run_recall(recall);
+        }
+    }
+    if (options.recall == "all" || options.recall == "perfect") {
+        bench.run_all_streets();
+    }
+    return 0;
+}
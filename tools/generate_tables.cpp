@@ -0,0 +1,59 @@
+/**
+ * generate_tables.cpp
+ *
+ * Writes the lookup tables of every built-in recall type as a C++ source file. Builds
+ * with HAND_ISOMORPHISM_STATIC_TABLES compile it into the library, so the built-in
+ * indexers are read only data that needs no allocation or initialization.
+ *
+ * Usage: generate_tables <output.cpp>
+ */
+
+#include "hand_isomorphism.h"
+
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+int main(int argc, char **argv){
+    if (argc != 2) {
+        std::fprintf(stderr, "usage: %s <output.cpp>\n", argv[0]);
+        return 1;
+    }
+
+    const std::string output = argv[1];
+    const std::string image_path = output + ".bin";
+    if (!hand_isomorphism_save_tables(image_path.c_str())) {
+        std::fprintf(stderr, "%s: could not save the tables to %s\n", argv[0], image_path.c_str());
+        return 1;
+    }
+
+    std::ifstream image_file(image_path, std::ios::binary);
+    std::vector<char> image((std::istreambuf_iterator<char>(image_file)), std::istreambuf_iterator<char>());
+    image_file.close();
+    std::remove(image_path.c_str());
+    image.resize((image.size() + 7) / 8 * 8);
+
+    FILE *source = std::fopen(output.c_str(), "w");
+    if (!source) {
+        std::fprintf(stderr, "%s: could not write %s\n", argv[0], output.c_str());
+        return 1;
+    }
+
+    std::fprintf(source, "// Generated by tools/generate_tables.cpp. Do not edit.\n\n");
+    std::fprintf(source, "#include <cstddef>\n#include <cstdint>\n\n");
+    std::fprintf(source, "alignas(64) extern const uint64_t hand_isomorphism_builtin_tables[] = {");
+    for (size_t i = 0; i < image.size(); i += 8)
+    {
+        uint64_t word;
+        std::memcpy(&word, &image[i], sizeof(word));
+        std::fprintf(source, "%s0x%" PRIx64 ",", i % 64 ? "" : "\n    ", word);
+    }
+    std::fprintf(source, "\n};\n\n");
+    std::fprintf(source, "extern const size_t hand_isomorphism_builtin_tables_size = %zu;\n", image.size());
+
+    return std::fclose(source) == 0 ? 0 : 1;
+}